@@ -0,0 +1,38 @@
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;;;; Pointers Assembler ;;;;
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+
+; RAM operands in every form, the output is the same in all numeric variants:
+; OUT: 5, OUT: 3, OUT: 3, OUT: 12, OUT: 2.500000, OUT: 7
+
+main:
+
+	push   5
+	out
+
+	push   3
+	pop    [0]
+	push   [0]
+	out
+
+	push   16
+	pop    rax
+	push   [rax-16]
+	out
+
+	push   12
+	pop    [rax+8]
+	push   [24]
+	out
+
+	pushq  2.5
+	popq   [rax]
+	pushq  [16]
+	outq
+
+	push   7
+	pop    [rax+32]
+	push   [48]
+	out
+
+	hlt
@@ -16,7 +16,21 @@ Assembler::Assembler (const char* filename) :
     input_ (filename),
     bcode_ (DEFAULT_BCODE_SIZE),
     state_ (ASM_OK)
-{ }
+{
+    BinHeader header;
+    MakeBinHeader(&header);
+
+    key_ = fast_hash(&header,      BIN_HEADER_SIZE);
+    key_ = fast_hash(&ASM_VERSION, sizeof(ASM_VERSION), key_);
+
+    // the text is cut while assembling, so it is identified now
+    if (input_.text_ != nullptr)
+    {
+        key_       = fast_hash(input_.text_, input_.size_, key_);
+        text_hash_ = fast_hash(input_.text_, input_.size_);
+        text_size_ = input_.size_;
+    }
+}
 
 //------------------------------------------------------------------------------
 
@@ -133,6 +147,22 @@ int Assembler::Assemble ()
             WriteRegister(operand_word, line_cur, ASM_WRONG_SCREEN_OPERAND_REGISTER);
             break;
 
+        case CMD_HCALL:
+
+            ASM_ASSERTOK((operand_word == NULL), ASM_WRONG_HCALL_OPERAND, line_cur);
+
+            WriteCommandSingle(cmd_code, 0x00);
+            WriteHostCall(operand_word, line_cur, ASM_WRONG_HCALL_OPERAND);
+            break;
+
+        case CMD_LCALL:
+
+            ASM_ASSERTOK((operand_word == NULL), ASM_WRONG_LCALL_OPERAND, line_cur);
+
+            WriteCommandSingle(cmd_code, 0x00);
+            WriteModule(operand_word, line_cur, ASM_WRONG_LCALL_OPERAND);
+            break;
+
         default:
             if (isJUMP(cmd_code))
             {
@@ -164,28 +194,84 @@ int Assembler::Assemble ()
 
 //------------------------------------------------------------------------------
 
-int Assembler::Write (char* filename)
+int Assembler::Write (char* filename, const char* cache)
 {
     ASM_ASSERTOK((this == nullptr),     ASM_NULL_INPUT_ASSEMBLER_PTR, -1);
     ASM_ASSERTOK((filename == nullptr), ASM_NULL_INPUT_FILENAME,      -1);
 
-    char newname[65] = "";
-    filename = GetTrueFileName(filename);
-    strcpy(newname, filename);
-    strcat(newname, CODE_TYPE);
+    char newname[MAX_NAME_LEN] = "";
+    MakeBinName(newname, filename);
 
     FILE* fp = nullptr;
     fp = fopen(newname, "wb");
 
+    BinHeader header;
+    MakeBinHeader(&header);
+
+    fwrite(&header, 1, BIN_HEADER_SIZE, fp);
     fwrite(bcode_.data_, 1, bcode_.ptr_, fp);
 
     fclose(fp);
 
+    if (cache == nullptr) return ASM_OK;
+
+    ASM_ASSERTOK((! MakeDir(cache)), ASM_CACHE_DIR_ERROR, -1);
+
+    // the entry appears only when it is complete, so a parallel assembler never takes a half of it
+    char temp [MAX_NAME_LEN] = "";
+    char entry[MAX_NAME_LEN] = "";
+    snprintf(temp,  MAX_NAME_LEN, "%s/%016llX.%d.tmp", cache, key_, getpid());
+    snprintf(entry, MAX_NAME_LEN, "%s/%016llX%s",      cache, key_, CODE_TYPE);
+
+    AsmCacheHeader cached = {};
+    memcpy(cached.signature, ASM_CACHE_SIGNATURE, sizeof(cached.signature));
+    cached.text_size = text_size_;
+    cached.text_hash = text_hash_;
+
+    fp = fopen(temp, "wb");
+    if (fp == nullptr) return ASM_OK;
+
+    fwrite(&cached, sizeof(AsmCacheHeader), 1, fp);
+    fwrite(&header, 1, BIN_HEADER_SIZE, fp);
+    fwrite(bcode_.data_, 1, bcode_.ptr_, fp);
+
+    bool err = ferror(fp);
+    err = (fclose(fp) != 0) || err;
+
+    if (err || (rename(temp, entry) != 0)) remove(temp);
+
     return ASM_OK;
 }
 
 //------------------------------------------------------------------------------
 
+bool Assembler::Load (const char* filename, const char* cache)
+{
+    ASM_ASSERTOK((this == nullptr),                            ASM_NULL_INPUT_ASSEMBLER_PTR, -1);
+    ASM_ASSERTOK(((filename == nullptr) || (cache == nullptr)), ASM_NULL_INPUT_FILENAME,      -1);
+
+    char newname[MAX_NAME_LEN] = "";
+    MakeBinName(newname, filename);
+
+    char entry[MAX_NAME_LEN] = "";
+    snprintf(entry, MAX_NAME_LEN, "%s/%016llX%s", cache, key_, CODE_TYPE);
+
+    FILE* fp = fopen(entry, "rb");
+    if (fp == nullptr) return 0;
+
+    AsmCacheHeader cached = {};
+    bool hit = (fread(&cached, sizeof(AsmCacheHeader), 1, fp) == 1);
+    fclose(fp);
+
+    // equal keys of different programs are a miss, the entry is overwritten then
+    hit = hit && (memcmp(cached.signature, ASM_CACHE_SIGNATURE, sizeof(cached.signature)) == 0) &&
+                 (cached.text_size == text_size_) && (cached.text_hash == text_hash_);
+
+    return hit && CopyFile(entry, newname, sizeof(AsmCacheHeader));
+}
+
+//------------------------------------------------------------------------------
+
 char Assembler::CMDIdentify (const char* word)
 {
     assert(word != nullptr);
@@ -216,6 +302,44 @@ char Assembler::REGIdentify (const char* word)
 
 //------------------------------------------------------------------------------
 
+int Assembler::HCALLIdentify (const char* word)
+{
+    assert(word != nullptr);
+
+    struct command hcall_key = { 0, word };
+
+    struct command* p_hcall_struct = (struct command*)bsearch(&hcall_key, hcall_names, HCALL_NUM, sizeof(hcall_names[0]), CompareCMD_Names);
+
+    if (p_hcall_struct != nullptr) return (unsigned char)p_hcall_struct->code;
+
+    // functions of the embedding program have no names here, they are called by numbers
+    char* end_word = nullptr;
+    long  number   = strtol(word, &end_word, 0);
+
+    if (isdigit(word[0]) && (end_word[0] == '\0') && (number < HOST_FUNCS_NUM)) return (int)number;
+
+    return ASM_NOT_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void Assembler::MakeBinName (char* newname, const char* filename)
+{
+    assert(newname  != nullptr);
+    assert(filename != nullptr);
+
+    ASM_ASSERTOK((strlen(filename) >= MAX_NAME_LEN), ASM_TOO_LONG_FILENAME, -1);
+
+    char name[MAX_NAME_LEN] = "";
+    strcpy(name, filename);
+
+    // the binary goes to the current directory wherever the source is
+    int len = snprintf(newname, MAX_NAME_LEN, "%s%s", GetTrueFileName(name), CODE_TYPE);
+    ASM_ASSERTOK(((len < 0) || ((size_t)len >= MAX_NAME_LEN)), ASM_TOO_LONG_FILENAME, -1);
+}
+
+//------------------------------------------------------------------------------
+
 char* Assembler::DeleteComments (Line* line, const char comment)
 {
     assert(line != nullptr);
@@ -238,7 +362,7 @@ char* Assembler::DeleteComments (Line* line, const char comment)
 
 //------------------------------------------------------------------------------
 
-void Assembler::WriteIntNumber (char* op_word, size_t line, int err)
+void Assembler::WriteIntNumber (char* op_word, size_t line, int err, char flag)
 {
     assert(op_word != nullptr);
 
@@ -248,13 +372,18 @@ void Assembler::WriteIntNumber (char* op_word, size_t line, int err)
     INT_TYPE number = (INT_TYPE)strtod(op_word, &end_word);
     ASM_ASSERTOK((end_word[0] != '\0'), err, line);
 
-    if (bcode_.ptr_ == bcode_.size_ - NUMBER_INT_SIZE)
+    // an address in RAM is POINTER_SIZE in every variant, the cpu reads it so
+    PTR_TYPE    pointer = (PTR_TYPE)number;
+    const void* value   = (flag & PTR_FLAG) ? (const void*)&pointer : (const void*)&number;
+    size_t      size    = (flag & PTR_FLAG) ? POINTER_SIZE           : NUMBER_INT_SIZE;
+
+    while (bcode_.size_ - bcode_.ptr_ <= size)
     {
         ASM_ASSERTOK((bcode_.Expand() == ASM_NO_MEMORY), ASM_NO_MEMORY, -1);
     }
 
-    memcpy(bcode_.data_ + bcode_.ptr_, &number, NUMBER_INT_SIZE);
-    bcode_.ptr_ += NUMBER_INT_SIZE;
+    memcpy(bcode_.data_ + bcode_.ptr_, value, size);
+    bcode_.ptr_ += size;
 }
 
 //------------------------------------------------------------------------------
@@ -277,7 +406,7 @@ void Assembler::WriteCommandWithIntNumber (char cmd_code, char* op_word, size_t
 
     WriteCommandSingle(cmd_code, NUM_FLAG | flag);
 
-    WriteIntNumber(op_word, line, err);
+    WriteIntNumber(op_word, line, err, flag);
 }
 
 //------------------------------------------------------------------------------
@@ -330,6 +459,46 @@ void Assembler::WriteRegister (char* op_word, size_t line, int err)
 
 //------------------------------------------------------------------------------
 
+void Assembler::WriteHostCall (char* op_word, size_t line, int err)
+{
+    assert(op_word != nullptr);
+
+    int hcall_code = HCALLIdentify(op_word);
+    ASM_ASSERTOK((hcall_code == ASM_NOT_OK), err, line);
+
+    if (bcode_.ptr_ == bcode_.size_ - 1)
+    {
+        ASM_ASSERTOK((bcode_.Expand() == ASM_NO_MEMORY), ASM_NO_MEMORY, -1);
+    }
+
+    bcode_.data_[bcode_.ptr_++] = (char)hcall_code;
+}
+
+//------------------------------------------------------------------------------
+
+void Assembler::WriteModule (char* op_word, size_t line, int err)
+{
+    assert(op_word != nullptr);
+
+    size_t len = strlen(op_word);
+    ASM_ASSERTOK((len > MODULE_NAME_LEN), err, line);
+
+    while (bcode_.size_ - bcode_.ptr_ < POINTER_SIZE + 1 + len + 1)
+    {
+        ASM_ASSERTOK((bcode_.Expand() == ASM_NO_MEMORY), ASM_NO_MEMORY, -1);
+    }
+
+    // the module is not loaded yet
+    memset(bcode_.data_ + bcode_.ptr_, 0, POINTER_SIZE);
+    bcode_.ptr_ += POINTER_SIZE;
+
+    bcode_.data_[bcode_.ptr_++] = (char)len;
+    memcpy(bcode_.data_ + bcode_.ptr_, op_word, len);
+    bcode_.ptr_ += len;
+}
+
+//------------------------------------------------------------------------------
+
 void Assembler::WriteCommandWithPointer (char cmd_code, char* op_word, size_t line, int err)
 {
     assert(op_word != nullptr);
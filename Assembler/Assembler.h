@@ -32,7 +32,10 @@
 
 #include <time.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "../Commands.h"
+#include "../StackLib/hash.h"
 #include "../StringLib/StringLib.h"
 
 
@@ -49,6 +52,7 @@ enum AssemblerErrors
     ASM_OK = 0                                                         ,
     ASM_NO_MEMORY                                                      ,
 
+    ASM_CACHE_DIR_ERROR                                                ,
     ASM_DESTRUCTED                                                     ,
     ASM_EXTRA_WORD                                                     ,
     ASM_INCORRECT_LABEL_INPUT                                          ,
@@ -59,9 +63,12 @@ enum AssemblerErrors
     ASM_NULL_INPUT_ASSEMBLER_PTR                                       ,
     ASM_NULL_INPUT_FILENAME                                            ,
     ASM_NULL_INPUT_LABELS_PTR                                          ,
+    ASM_TOO_LONG_FILENAME                                              ,
     ASM_TOO_MANY_WORDS_IN_LINE                                         ,
     ASM_UNIDENTIFIED_COMMAND                                           ,
+    ASM_WRONG_HCALL_OPERAND                                            ,
     ASM_WRONG_IN_OPERAND_REGISTER                                      ,
+    ASM_WRONG_LCALL_OPERAND                                            ,
     ASM_WRONG_OUT_OPERAND_REGISTER                                     ,
     ASM_WRONG_POP_OPERAND_POINTER                                      ,
     ASM_WRONG_POP_OPERAND_REGISTER                                     ,
@@ -79,6 +86,7 @@ char const * const asm_errstr[] =
     "OK"                                                               ,
     "Failed to allocate memory"                                        ,
 
+    "Failed to create the cache directory"                             ,
     "Assembler has already destructed"                                 ,
     "Extra word found"                                                 ,
     "Incorrect label input"                                            ,
@@ -89,9 +97,12 @@ char const * const asm_errstr[] =
     "The input value of the assembler pointer turned out to be zero"   ,
     "The input value of the assembler filename turned out to be zero"  ,
     "The input value of the labels pointer turned out to be zero"      ,
+    "File name of the binary program is too long"                      ,
     "Too many words in line"                                           ,
     "Unidentified command"                                             ,
+    "Wrong hcall operand. Operand can only be a host function or a byte",
     "Wrong in operand register"                                        ,
+    "Wrong lcall operand. Operand can only be a module name up to 16 chars",
     "Wrong out operand register"                                       ,
     "Wrong pop operand pointer"                                        ,
     "Wrong pop operand register"                                       ,
@@ -201,12 +212,26 @@ public:
 
 const size_t DEFAULT_BCODE_SIZE = 1024;
 const size_t MAX_WORDS_IN_LINE  = 2;
+const size_t MAX_NAME_LEN       = 256;
 
 char const * const CODE_TYPE = ".bin";
 const char         COMMENT   = ';';
 
 char const * const DELIMETERS = " \t\r\0";
 
+// the version is a part of the cache key, it is bumped when the encoding of commands changes
+const int ASM_VERSION = 1;
+
+#define ASM_CACHE_SIGNATURE "PZAC"
+
+// cache entry: header, then the binary program; the text is checked to tell apart equal keys
+struct AsmCacheHeader
+{
+    char   signature[4];
+    size_t text_size;
+    hash_t text_hash;
+};
+
 
 class Assembler
 {
@@ -222,6 +247,10 @@ private:
 
     char* prev_line_ = nullptr;
 
+    hash_t key_       = 0;
+    hash_t text_hash_ = 0;
+    size_t text_size_ = 0;
+
 public:
 
 //------------------------------------------------------------------------------
@@ -263,13 +292,32 @@ public:
 
 //------------------------------------------------------------------------------
 /*! @brief   Write binary program text to the file.
+ *
+ *  @note    The binary program is written to the current directory, as on a cache hit.
  *
  *  @param   filename    File name for the binary program
+ *  @param   cache       Name of the cache directory to keep a copy of the binary program in
  *
  *  @return  error code
  */
 
-    int Write (char* filename);
+    int Write (char* filename, const char* cache = nullptr);
+
+//------------------------------------------------------------------------------
+/*! @brief   Take the binary program from the cache instead of assembling.
+ *
+ *  @note    Cached binaries are named after the hash of the program text and the assembler
+ *           version, the size and another hash of the text are checked before a hit is
+ *           taken, so a hit needs no parsing at all. The binary program is copied to
+ *           the current directory, where Write puts it.
+ *
+ *  @param   filename    File name for the binary program
+ *  @param   cache       Name of the cache directory
+ *
+ *  @return  1 if the binary program was found in the cache, else 0
+ */
+
+    bool Load (const char* filename, const char* cache);
 
 /*------------------------------------------------------------------------------
                    Private functions                                           *
@@ -297,6 +345,25 @@ private:
 
     char REGIdentify (const char* word);
 
+//------------------------------------------------------------------------------
+/*! @brief   Host function identifier.
+ *
+ *  @param   word        C string to be recognized as a host function name or number
+ *
+ *  @return  host function code if found else NOT_OK
+ */
+
+    int HCALLIdentify (const char* word);
+
+//------------------------------------------------------------------------------
+/*! @brief   Make the name of the binary program: the true name of the file with CODE_TYPE.
+ *
+ *  @param   newname     Buffer of MAX_NAME_LEN chars for the name
+ *  @param   filename    File name of the program text
+ */
+
+    void MakeBinName (char* newname, const char* filename);
+
 //------------------------------------------------------------------------------
 /*! @brief   Delete comments in the line.
  *
@@ -317,7 +384,7 @@ private:
  *  @param   flag        Additional command flag
  */
 
-    void WriteIntNumber (char* op_word, size_t line, int err);
+    void WriteIntNumber (char* op_word, size_t line, int err, char flag = 0);
 
 //------------------------------------------------------------------------------
 /*! @brief   Write command without any operands to the binary code.
@@ -373,6 +440,26 @@ private:
 
     void WriteRegister (char* op_word, size_t line, int err);
 
+//------------------------------------------------------------------------------
+/*! @brief   Write host function operand to the binary code.
+ *
+ *  @param   op_word     Operand word to be recognized as a host function
+ *  @param   line        Number of line in the program text
+ *  @param   err         Error code
+ */
+
+    void WriteHostCall (char* op_word, size_t line, int err);
+
+//------------------------------------------------------------------------------
+/*! @brief   Write code module operand to the binary code.
+ *
+ *  @param   op_word     Name of the module
+ *  @param   line        Number of line in the program text
+ *  @param   err         Error code
+ */
+
+    void WriteModule (char* op_word, size_t line, int err);
+
 //------------------------------------------------------------------------------
 /*! @brief   Write command with pointer operand to the binary code.
  *
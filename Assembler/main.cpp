@@ -14,6 +14,19 @@
 
 int main(int argc, char* argv[])
 {
+    if ((argc == 4) && (strcmp(argv[1], "--cache") == 0))
+    {
+        Assembler assembler(argv[3]);
+
+        if (assembler.Load(argv[3], argv[2])) return 0;
+
+        assembler.Assemble();
+
+        assembler.Write(argv[3], argv[2]);
+
+        return 0;
+    }
+
     if (argc != 2)
     {
         printf("wrong input parameters");
@@ -0,0 +1,164 @@
+/*------------------------------------------------------------------------------
+    * File:        AsyncIO.cpp                                                 *
+    * Description: Functions for reading and writing streams of the cpu        *
+                   without stopping it                                         *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "AsyncIO.h"
+
+//------------------------------------------------------------------------------
+
+AsyncIO::AsyncIO () { }
+
+//------------------------------------------------------------------------------
+
+AsyncIO::~AsyncIO ()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+    }
+    submitted_.notify_one();
+
+    if (thread_.joinable()) thread_.join();
+}
+
+//------------------------------------------------------------------------------
+
+int AsyncIO::Submit (int type, FILE* fp, char* buf, size_t len)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    int id = 0;
+    while ((id < AIO_REQUESTS_NUM) && (requests_[id].state != AIO_FREE)) ++id;
+    if (id == AIO_REQUESTS_NUM) return -1;
+
+    requests_[id].type   = type;
+    requests_[id].state  = AIO_QUEUED;
+    requests_[id].fp     = fp;
+    requests_[id].buf    = buf;
+    requests_[id].len    = len;
+    requests_[id].result = 0;
+
+    queue_.push_back(id);
+
+    if (!thread_.joinable()) thread_ = std::thread(&AsyncIO::Worker, this);
+    submitted_.notify_one();
+
+    return id;
+}
+
+//------------------------------------------------------------------------------
+
+int AsyncIO::Poll (long id)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    if ((id < 0) || (id >= AIO_REQUESTS_NUM) || (requests_[id].state == AIO_FREE)) return -1;
+
+    return (requests_[id].state == AIO_DONE);
+}
+
+//------------------------------------------------------------------------------
+
+int AsyncIO::Wait (long id, long* result)
+{
+    std::unique_lock<std::mutex> guard(lock_);
+
+    if ((id < 0) || (id >= AIO_REQUESTS_NUM) || (requests_[id].state == AIO_FREE)) return -1;
+
+    completed_.wait(guard, [&]{ return requests_[id].state == AIO_DONE; });
+
+    *result = requests_[id].result;
+    requests_[id].state = AIO_FREE;
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncIO::Drain ()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+
+    completed_.wait(guard, [&]{ return queue_.empty() && !busy_; });
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncIO::Clear ()
+{
+    Drain();
+
+    std::lock_guard<std::mutex> guard(lock_);
+
+    for (int i = 0; i < AIO_REQUESTS_NUM; ++i)
+    {
+        requests_[i].state = AIO_FREE;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncIO::setNotify (AsyncNotify func, void* data)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+
+    notify_      = func;
+    notify_data_ = data;
+}
+
+//------------------------------------------------------------------------------
+
+void AsyncIO::Worker ()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+
+    while (true)
+    {
+        submitted_.wait(guard, [&]{ return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+
+        AsyncRequest& request = requests_[queue_.front()];
+        queue_.pop_front();
+        busy_ = true;
+
+        guard.unlock();
+
+        long result = 0;
+        if (request.type == AIO_READ)
+        {
+            result = fread(request.buf, 1, request.len, request.fp);
+        }
+        else
+        {
+            result = fwrite(request.buf, 1, request.len, request.fp);
+            fflush(request.fp);
+        }
+
+        guard.lock();
+
+        request.result = result;
+        request.state  = AIO_DONE;
+        busy_ = false;
+
+        completed_.notify_all();
+
+        AsyncNotify notify = notify_;
+        void*       data   = notify_data_;
+
+        if (notify != nullptr)
+        {
+            guard.unlock();
+            notify(data);
+            guard.lock();
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
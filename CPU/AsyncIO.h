@@ -0,0 +1,178 @@
+/*------------------------------------------------------------------------------
+    * File:        AsyncIO.h                                                   *
+    * Description: Declaration of functions and data types used for reading    *
+                   and writing streams of the cpu without stopping it          *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef ASYNCIO_H_INCLUDED
+#define ASYNCIO_H_INCLUDED
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <stdio.h>
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Asynchronous I/O constants and types                        *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+const int AIO_REQUESTS_NUM = 64;
+
+// called on the I/O thread after each done request
+typedef void (*AsyncNotify) (void* data);
+
+enum AsyncTypes
+{
+    AIO_READ                                                           ,
+    AIO_WRITE                                                          ,
+};
+
+enum AsyncStates
+{
+    AIO_FREE                                                           ,
+    AIO_QUEUED                                                         ,
+    AIO_DONE                                                           ,
+};
+
+struct AsyncRequest
+{
+    int    type   = AIO_READ;
+    int    state  = AIO_FREE;
+
+    FILE*  fp     = nullptr;
+    char*  buf    = nullptr;
+    size_t len    = 0;
+
+    long   result = 0;
+};
+
+class AsyncIO
+{
+private:
+
+    std::mutex              lock_;
+    std::condition_variable submitted_;
+    std::condition_variable completed_;
+
+    std::deque<int> queue_;
+    AsyncRequest    requests_[AIO_REQUESTS_NUM];
+
+    std::thread thread_;
+    bool        stop_ = false;
+    bool        busy_ = false;
+
+    AsyncNotify notify_      = nullptr;
+    void*       notify_data_ = nullptr;
+
+public:
+
+//------------------------------------------------------------------------------
+/*! @brief   AsyncIO constructor.
+ *
+ *  @note    The I/O thread starts with the first request.
+ */
+
+    AsyncIO ();
+
+//------------------------------------------------------------------------------
+/*! @brief   AsyncIO copy constructor (deleted).
+ *
+ *  @param   obj         Source asynchronous I/O
+ */
+
+    AsyncIO (const AsyncIO& obj);
+
+    AsyncIO& operator = (const AsyncIO& obj); // deleted
+
+//------------------------------------------------------------------------------
+/*! @brief   AsyncIO destructor, finishes all submitted requests.
+ */
+
+   ~AsyncIO ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Submit a request.
+ *
+ *  @note    Requests are done one by one in the order of submission, so the data
+ *           of a stream keeps its order.
+ *
+ *  @param   type        AIO_READ or AIO_WRITE
+ *  @param   fp          Stream
+ *  @param   buf         Buffer to read to or to write from
+ *  @param   len         Number of bytes
+ *
+ *  @return  request id, -1 if there are too many requests
+ */
+
+    int Submit (int type, FILE* fp, char* buf, size_t len);
+
+//------------------------------------------------------------------------------
+/*! @brief   Check the request without waiting.
+ *
+ *  @param   id          Request id
+ *
+ *  @return  1 if the request is done, 0 if not yet, -1 if there is no such request
+ */
+
+    int Poll (long id);
+
+//------------------------------------------------------------------------------
+/*! @brief   Wait for the request and free its id.
+ *
+ *  @param   id          Request id
+ *  @param   result      Pointer to the number of transferred bytes
+ *
+ *  @return  0 if done, -1 if there is no such request
+ */
+
+    int Wait (long id, long* result);
+
+//------------------------------------------------------------------------------
+/*! @brief   Wait for all submitted requests, their results stay until Wait.
+ */
+
+    void Drain ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Wait for all submitted requests and forget them.
+ */
+
+    void Clear ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Set the function called after each done request.
+ *
+ *  @param   func        Function, nullptr to call nothing
+ *  @param   data        Pointer passed to the function
+ */
+
+    void setNotify (AsyncNotify func, void* data = nullptr);
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   I/O thread main loop.
+ */
+
+    void Worker ();
+
+//------------------------------------------------------------------------------
+};
+
+//------------------------------------------------------------------------------
+
+#endif //ASYNCIO_H_INCLUDED
@@ -0,0 +1,477 @@
+/*------------------------------------------------------------------------------
+    * File:        Batch.cpp                                                   *
+    * Description: Functions to executing many binary programs on a pool of    *
+                   worker threads                                              *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Batch.h"
+
+//------------------------------------------------------------------------------
+
+Batch::Batch (const char* manifest, size_t workers) :
+    state_    (BATCH_OK),
+    manifest_ (manifest),
+    workers_  (workers),
+    next_job_ (0)
+{
+    if (workers_ == 0) workers_ = std::thread::hardware_concurrency();
+    if (workers_ == 0) workers_ = 1;
+
+    state_ = Init();
+}
+
+//------------------------------------------------------------------------------
+
+int Batch::Init ()
+{
+    for (size_t i = 0; i < manifest_.num_; ++i)
+    {
+        if ((manifest_.lines_[i].len != 0) && (manifest_.lines_[i].str[0] != BATCH_COMMENT)) ++jobs_num_;
+    }
+    BATCH_ASSERTOK((jobs_num_ == 0), BATCH_EMPTY_MANIFEST);
+
+    jobs_ = new (std::nothrow) BatchJob[jobs_num_];
+    BATCH_ASSERTOK((jobs_ == nullptr), BATCH_NO_MEMORY);
+
+    size_t job = 0;
+    for (size_t i = 0; i < manifest_.num_; ++i)
+    {
+        char* str = manifest_.lines_[i].str;
+        if ((manifest_.lines_[i].len == 0) || (str[0] == BATCH_COMMENT)) continue;
+
+        jobs_[job].program = str;
+        jobs_[job].input   = str + manifest_.lines_[i].len;
+
+        char* space = strpbrk(str, " \t");
+        if (space != nullptr)
+        {
+            *space = '\0';
+            jobs_[job].input = space + 1;
+        }
+
+        ++job;
+    }
+
+    return BATCH_OK;
+}
+
+//------------------------------------------------------------------------------
+
+Batch::~Batch ()
+{
+    assert(this != nullptr);
+
+    if (state_ == BATCH_DESTRUCTED) return;
+
+    for (size_t i = 0; (jobs_ != nullptr) && (i < jobs_num_); ++i)
+    {
+        free(jobs_[i].output);
+    }
+
+    delete [] jobs_;
+    jobs_ = nullptr;
+
+    state_ = BATCH_DESTRUCTED;
+}
+
+//------------------------------------------------------------------------------
+
+int Batch::Run ()
+{
+    BATCH_ASSERTOK((this == nullptr), BATCH_NULL_INPUT_BATCH_PTR);
+    BATCH_ASSERTOK(state_, state_);
+
+    size_t workers = (workers_ < jobs_num_) ? workers_ : jobs_num_;
+
+    std::thread* pool = new (std::nothrow) std::thread[workers];
+    BATCH_ASSERTOK((pool == nullptr), BATCH_NO_MEMORY);
+
+    next_job_ = 0;
+
+    for (size_t i = 0; i < workers; ++i)
+    {
+        pool[i] = std::thread(&Batch::Worker, this);
+    }
+
+    for (size_t i = 0; i < workers; ++i)
+    {
+        pool[i].join();
+    }
+
+    delete [] pool;
+
+    return BATCH_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int Batch::RunProcesses ()
+{
+    BATCH_ASSERTOK((this == nullptr), BATCH_NULL_INPUT_BATCH_PTR);
+    BATCH_ASSERTOK(state_, state_);
+
+    size_t workers = (workers_ < jobs_num_) ? workers_ : jobs_num_;
+    size_t size    = sizeof(BatchQueue) + (jobs_num_ - 1) * sizeof(BatchSlot);
+
+    BatchQueue* queue = (BatchQueue*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    BATCH_ASSERTOK((queue == MAP_FAILED), BATCH_NO_SHARED_MEMORY);
+
+    new (&queue->claimed) std::atomic<size_t> (0);
+    for (size_t i = 0; i < jobs_num_; ++i)
+    {
+        new (queue->slots + i) BatchSlot;
+        queue->slots[i].state = SLOT_WAITING;
+        queue->slots[i].pid   = 0;
+    }
+
+    // buffered output must not be written twice by the children
+    fflush(stdout);
+
+    size_t alive = 0;
+    for (size_t i = 0; i < workers; ++i)
+    {
+        if (StartWorker(queue) > 0) ++alive;
+    }
+
+    if (alive == 0)
+    {
+        munmap(queue, size);
+        BATCH_ASSERTOK(1, BATCH_NO_WORKER_PROCESS);
+    }
+
+    while (alive > 0)
+    {
+        int   status = 0;
+        pid_t pid    = WaitWorker(&status);
+        if (pid < 0) break;
+
+        --alive;
+
+        char reason[MAX_NAME_LEN] = "";
+        if (! GetWorkerCrash(status, reason, MAX_NAME_LEN)) continue;
+
+        for (size_t i = 0; i < jobs_num_; ++i)
+        {
+            if ((queue->slots[i].state != SLOT_DONE) && (queue->slots[i].pid == pid))
+            {
+                jobs_[i].crash = status;
+                strcpy(jobs_[i].reason, reason);
+                queue->slots[i].state = SLOT_DONE;
+            }
+        }
+
+        if ((queue->claimed < jobs_num_) && (StartWorker(queue) > 0)) ++alive;
+    }
+
+    for (size_t i = 0; i < jobs_num_; ++i)
+    {
+        BatchSlot* slot = queue->slots + i;
+        if (jobs_[i].crash != 0) continue;
+
+        jobs_[i].result    = slot->result;
+        jobs_[i].found     = slot->found;
+        jobs_[i].steps     = slot->steps;
+        jobs_[i].truncated = slot->truncated;
+
+        if (slot->output_len != 0)
+        {
+            jobs_[i].output = (char*)calloc(slot->output_len + 1, 1);
+            if (jobs_[i].output == nullptr) continue;
+
+            memcpy(jobs_[i].output, slot->output, slot->output_len);
+            jobs_[i].output_len = slot->output_len;
+        }
+    }
+
+    munmap(queue, size);
+
+    return BATCH_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int Batch::RunScheduled (size_t budget)
+{
+    BATCH_ASSERTOK((this == nullptr), BATCH_NULL_INPUT_BATCH_PTR);
+    BATCH_ASSERTOK(state_, state_);
+
+    SchedTask* tasks = new (std::nothrow) SchedTask[jobs_num_];
+    BATCH_ASSERTOK((tasks == nullptr), BATCH_NO_MEMORY);
+
+    Scheduler scheduler(workers_, budget);
+
+    int err = SCHED_OK;
+
+    for (size_t i = 0; (err == SCHED_OK) && (i < jobs_num_); ++i)
+    {
+        tasks[i].cpu = StartJob(jobs_ + i);
+        if (tasks[i].cpu != nullptr) err = scheduler.Add(tasks + i);
+    }
+
+    if (err == SCHED_OK) err = scheduler.Run();
+
+    for (size_t i = 0; i < jobs_num_; ++i)
+    {
+        if (tasks[i].cpu != nullptr) FinishJob(jobs_ + i, tasks[i].cpu, tasks[i].result);
+    }
+
+    delete [] tasks;
+
+    BATCH_ASSERTOK((err != SCHED_OK), BATCH_NOT_OK);
+
+    return BATCH_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int Batch::Write (const char* filename)
+{
+    BATCH_ASSERTOK((this == nullptr),     BATCH_NULL_INPUT_BATCH_PTR);
+    BATCH_ASSERTOK((filename == nullptr), BATCH_NULL_INPUT_FILENAME);
+    BATCH_ASSERTOK(state_, state_);
+
+    FILE* fp = fopen(filename, "w");
+    BATCH_ASSERTOK((fp == nullptr), BATCH_RESULTS_FILE_ERROR);
+
+    size_t failed = 0;
+
+    for (size_t i = 0; i < jobs_num_; ++i)
+    {
+        BatchJob* job = jobs_ + i;
+
+        fprintf(fp, ";;;; job %zu: %s%s%s ;;;;\n", i + 1, job->program, ((job->input[0] == '\0') ? "" : " "), job->input);
+
+        if (job->output_len != 0)
+        {
+            fwrite(job->output, 1, job->output_len, fp);
+            if (job->output[job->output_len - 1] != '\n') fprintf(fp, "\n");
+        }
+
+        const char* crash  = job->reason;
+        const char* result = "OK";
+        if (crash[0] != '\0')
+            result = crash;
+        else
+        if (! job->found)
+            result = "Input file is not found";
+        else
+        if (job->result > 0)
+            result = cpu_errstr[job->result + 1];
+
+        if ((crash[0] != '\0') || (! job->found) || (job->result > 0)) ++failed;
+
+        fprintf(fp, ";;;; result: %s, steps: %zu", result, job->steps);
+        if (job->truncated) fprintf(fp, ", output is cut to %zu bytes", BATCH_OUTPUT_SIZE);
+        fprintf(fp, " ;;;;\n\n");
+    }
+
+    fclose(fp);
+
+    printf("%zu jobs done, %zu failed, results are in \"%s\"\n", jobs_num_, failed, filename);
+
+    return BATCH_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void Batch::Worker ()
+{
+    for (size_t job = next_job_++; job < jobs_num_; job = next_job_++)
+    {
+        RunJob(jobs_ + job);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Batch::RunJob (BatchJob* job)
+{
+    assert(job != nullptr);
+
+    CPU* cpu = StartJob(job);
+    if (cpu == nullptr) return;
+
+    FinishJob(job, cpu, cpu->Execute());
+}
+
+//------------------------------------------------------------------------------
+
+CPU* Batch::StartJob (BatchJob* job)
+{
+    assert(job != nullptr);
+
+    FILE* fp = fopen(job->program, "rb");
+    if (fp == nullptr)
+    {
+        job->found = false;
+        return nullptr;
+    }
+
+    size_t size = CountSize(fp);
+    fclose(fp);
+
+    if (size == 0)
+    {
+        job->result = CPU_EMPTY_PROGRAM;
+        return nullptr;
+    }
+
+    // jobs of one program share its image
+    std::shared_ptr<const ProgramImage> image = GetImage(job->program);
+
+    if (image == nullptr)
+    {
+        job->found = false;
+        return nullptr;
+    }
+
+    if (image->variant != NUM_VARIANT)
+    {
+        job->result = CPU_WRONG_NUM_VARIANT;
+        return nullptr;
+    }
+
+    job->image = image;
+
+    // the terminating zero is readable, so that an empty input is not an empty buffer
+    FILE* in  = fmemopen(job->input, strlen(job->input) + 1, "r");
+    FILE* out = open_memstream(&job->output, &job->output_len);
+
+    if ((in == nullptr) || (out == nullptr))
+    {
+        if (in  != nullptr) fclose(in);
+        if (out != nullptr) fclose(out);
+
+        job->result = CPU_NO_MEMORY;
+        return nullptr;
+    }
+
+    // parallel jobs of one program must not write the same screen files
+    char progname[MAX_NAME_LEN] = "";
+    char scrname [MAX_NAME_LEN] = "";
+    strncpy(progname, job->program, MAX_NAME_LEN - 1);
+    snprintf(scrname, MAX_NAME_LEN, "%s.job%zu", GetTrueFileName(progname), (size_t)(job - jobs_) + 1);
+
+    CPU* cpu = new (std::nothrow) CPU(image, job->program);
+    if (cpu == nullptr)
+    {
+        fclose(in);
+        fclose(out);
+
+        job->result = CPU_NO_MEMORY;
+        return nullptr;
+    }
+
+    cpu->setLogging(false);
+    cpu->setIO(in, out);
+    cpu->setHeadless(true);
+    cpu->setScreenName(scrname);
+
+    job->in_stream  = in;
+    job->out_stream = out;
+
+    return cpu;
+}
+
+//------------------------------------------------------------------------------
+
+void Batch::FinishJob (BatchJob* job, CPU* cpu, int result)
+{
+    assert(job != nullptr);
+    assert(cpu != nullptr);
+
+    job->result = result;
+    job->steps  = cpu->getSteps();
+
+    delete cpu;
+
+    fclose(job->in_stream);
+    fclose(job->out_stream);
+
+    job->in_stream  = nullptr;
+    job->out_stream = nullptr;
+}
+
+//------------------------------------------------------------------------------
+
+void Batch::ProcessWorker (BatchQueue* queue)
+{
+    assert(queue != nullptr);
+
+    pid_t self = getpid();
+
+    for (size_t job = 0; job < jobs_num_; ++job)
+    {
+        BatchSlot* slot = queue->slots + job;
+
+        // the pid is the claim, a worker that dies right after it is still found by the supervisor
+        pid_t owner = 0;
+        if (! slot->pid.compare_exchange_strong(owner, self)) continue;
+
+        ++queue->claimed;
+        slot->state = SLOT_RUNNING;
+
+        RunJob(jobs_ + job);
+
+        slot->result = jobs_[job].result;
+        slot->found  = jobs_[job].found;
+        slot->steps  = jobs_[job].steps;
+
+        slot->truncated  = (jobs_[job].output_len > BATCH_OUTPUT_SIZE);
+        slot->output_len = (slot->truncated) ? BATCH_OUTPUT_SIZE : jobs_[job].output_len;
+        if (slot->output_len != 0) memcpy(slot->output, jobs_[job].output, slot->output_len);
+
+        free(jobs_[job].output);
+        jobs_[job].output = nullptr;
+
+        slot->state = SLOT_DONE;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+pid_t Batch::StartWorker (BatchQueue* queue)
+{
+    assert(queue != nullptr);
+
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+
+    ProcessWorker(queue);
+
+    // the child must not run destructors of the supervisor objects
+    _exit(0);
+}
+
+//------------------------------------------------------------------------------
+
+void BatchPrintError(const char* logname, const char* file, int line, const char* function, int err)
+{
+    assert(function != nullptr);
+    assert(logname  != nullptr);
+    assert(file     != nullptr);
+
+    FILE* log = fopen(logname, "a");
+    assert(log != nullptr);
+
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+
+    fprintf(log, "###############################################################################\n");
+    fprintf(log, "TIME: %d-%02d-%02d %02d:%02d:%02d\n\n",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    fprintf(log, "ERROR: file %s  line %d  function %s\n\n", file, line, function);
+    fprintf(log, "%s\n", batch_errstr[err + 1]);
+
+    printf (     "ERROR: file %s  line %d  function %s\n",   file, line, function);
+    printf (     "%s\n\n", batch_errstr[err + 1]);
+
+    fclose(log);
+}
+
+//------------------------------------------------------------------------------
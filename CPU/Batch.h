@@ -0,0 +1,303 @@
+/*------------------------------------------------------------------------------
+    * File:        Batch.h                                                     *
+    * Description: Declaration of functions and data types used for executing  *
+                   many binary programs on a pool of worker threads            *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef BATCH_H_INCLUDED
+#define BATCH_H_INCLUDED
+
+#include <atomic>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "CPU.h"
+#include "Scheduler.h"
+#include "Worker.h"
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Batch errors                                                *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+enum BatchErrors
+{
+    BATCH_NOT_OK = -1                                                  ,
+    BATCH_OK = 0                                                       ,
+    BATCH_NO_MEMORY                                                    ,
+
+    BATCH_DESTRUCTED                                                   ,
+    BATCH_EMPTY_MANIFEST                                               ,
+    BATCH_NULL_INPUT_BATCH_PTR                                         ,
+    BATCH_NULL_INPUT_FILENAME                                          ,
+    BATCH_NO_SHARED_MEMORY                                             ,
+    BATCH_NO_WORKER_PROCESS                                            ,
+    BATCH_RESULTS_FILE_ERROR                                           ,
+};
+
+char const * const batch_errstr[] =
+{
+    "ERROR"                                                            ,
+    "OK"                                                               ,
+    "Failed to allocate memory"                                        ,
+
+    "Batch has already destructed"                                     ,
+    "Manifest has no jobs"                                             ,
+    "The input value of the batch pointer turned out to be zero"       ,
+    "The input value of the batch filename turned out to be zero"      ,
+    "Failed to map the shared memory"                                  ,
+    "Failed to start a worker process"                                 ,
+    "Failed to open the results file"                                  ,
+};
+
+#define BATCH_ASSERTOK(cond, err) if (cond)                                                               \
+                                  {                                                                       \
+                                    BatchPrintError(CPU_LOGNAME, __FILE__, __LINE__, __FUNC_NAME__, err); \
+                                    return err;                                                           \
+                                  } //
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Batch constants and types                                   *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+char const * const BATCH_RESULTS = "batch.txt";
+char const         BATCH_COMMENT = ';';
+
+const size_t BATCH_OUTPUT_SIZE = 4096;
+
+enum BatchSlotStates
+{
+    SLOT_WAITING                                                       ,
+    SLOT_RUNNING                                                       ,
+    SLOT_DONE                                                          ,
+};
+
+struct BatchJob
+{
+    char*  program    = nullptr;
+    char*  input      = nullptr;
+
+    int    result     = CPU_OK;
+    bool   found      = true;
+    int    crash      = 0;
+    size_t steps      = 0;
+
+    char*  output     = nullptr;
+    size_t output_len = 0;
+    bool   truncated  = false;
+
+    FILE*  in_stream  = nullptr;
+    FILE*  out_stream = nullptr;
+
+    char   reason[MAX_NAME_LEN] = "";
+
+    // held until the batch ends, so that later jobs of the program find it loaded
+    std::shared_ptr<const ProgramImage> image;
+};
+
+// job result in the memory shared between the supervisor and the worker processes,
+// a worker claims the slot by writing its pid, so that the job is never left without an owner
+struct BatchSlot
+{
+    std::atomic<int>   state;
+    std::atomic<pid_t> pid;
+
+    int    result     = CPU_OK;
+    bool   found      = true;
+    size_t steps      = 0;
+
+    size_t output_len = 0;
+    bool   truncated  = false;
+    char   output[BATCH_OUTPUT_SIZE];
+};
+
+struct BatchQueue
+{
+    std::atomic<size_t> claimed;
+    BatchSlot           slots[1];
+};
+
+class Batch
+{
+private:
+
+    int state_;
+
+    Text manifest_;
+
+    BatchJob* jobs_     = nullptr;
+    size_t    jobs_num_ = 0;
+    size_t    workers_  = 0;
+
+    std::atomic<size_t> next_job_;
+
+public:
+
+//------------------------------------------------------------------------------
+/*! @brief   Batch constructor.
+ *
+ *  @note    Each line of the manifest is a job: name of a binary code file and
+ *           the input of the program separated by spaces. Empty lines and lines
+ *           starting with ';' are skipped.
+ *
+ *  @param   manifest    Name of the manifest file
+ *  @param   workers     Number of worker threads, 0 means number of cores
+ */
+
+    Batch (const char* manifest, size_t workers = 0);
+
+//------------------------------------------------------------------------------
+/*! @brief   Batch copy constructor (deleted).
+ *
+ *  @param   obj         Source batch
+ */
+
+    Batch (const Batch& obj);
+
+    Batch& operator = (const Batch& obj); // deleted
+
+//------------------------------------------------------------------------------
+/*! @brief   Batch destructor.
+ */
+
+   ~Batch ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Execute all jobs of the manifest on the worker threads.
+ *
+ *  @return  error code
+ */
+
+    int Run ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Execute all jobs of the manifest on the worker processes.
+ *
+ *  @note    Jobs and results are passed through the shared memory, so a worker that
+ *           crashes takes only its current job with it. The supervisor records the
+ *           reason of the crash for this job and starts a new worker instead.
+ *
+ *  @return  error code
+ */
+
+    int RunProcesses ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Execute all jobs of the manifest as tasks of the scheduler.
+ *
+ *  @note    Every job has its own cpu, and the workers switch between them after
+ *           a budget of instructions, so that long jobs do not hold up the short ones.
+ *
+ *  @param   budget      Number of instructions a job executes before it gives way to the others
+ *
+ *  @return  error code
+ */
+
+    int RunScheduled (size_t budget = DEFAULT_BUDGET);
+
+//------------------------------------------------------------------------------
+/*! @brief   Write outputs and results of all jobs in the manifest order.
+ *
+ *  @param   filename    Name of the results file
+ *
+ *  @return  error code
+ */
+
+    int Write (const char* filename = BATCH_RESULTS);
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   Split the manifest into jobs.
+ *
+ *  @return  error code
+ */
+
+    int Init ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Take jobs one by one until all of them are done.
+ */
+
+    void Worker ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Execute a job on its own cpu with the job input and output.
+ *
+ *  @param   job         Pointer to the job
+ */
+
+    void RunJob (BatchJob* job);
+
+//------------------------------------------------------------------------------
+/*! @brief   Check the job and make its cpu with the job input and output.
+ *
+ *  @param   job         Pointer to the job
+ *
+ *  @return  pointer to the cpu, nullptr if the job failed already
+ */
+
+    CPU* StartJob (BatchJob* job);
+
+//------------------------------------------------------------------------------
+/*! @brief   Take the result of the job and free its cpu.
+ *
+ *  @param   job         Pointer to the job
+ *  @param   cpu         Pointer to the cpu of the job
+ *  @param   result      Result of the cpu
+ */
+
+    void FinishJob (BatchJob* job, CPU* cpu, int result);
+
+//------------------------------------------------------------------------------
+/*! @brief   Worker process main loop, takes jobs from the shared queue.
+ *
+ *  @param   queue       Pointer to the shared queue
+ */
+
+    void ProcessWorker (BatchQueue* queue);
+
+//------------------------------------------------------------------------------
+/*! @brief   Start a worker process.
+ *
+ *  @param   queue       Pointer to the shared queue
+ *
+ *  @return  worker pid, -1 if failed
+ */
+
+    pid_t StartWorker (BatchQueue* queue);
+
+//------------------------------------------------------------------------------
+};
+
+//------------------------------------------------------------------------------
+/*! @brief   Prints an error wih description to the console and to the log file.
+ *
+ *  @param   logname     Name of the log file
+ *  @param   file        Name of the program file
+ *  @param   line        Number of line with an error
+ *  @param   function    Name of the function with an error
+ *  @param   err         Error code
+ */
+
+void BatchPrintError (const char* logname, const char* file, int line, const char* function, int err);
+
+//------------------------------------------------------------------------------
+
+#endif //BATCH_H_INCLUDED
@@ -12,6 +12,181 @@
 
 //------------------------------------------------------------------------------
 
+static int HostAbs (CPU* cpu, void*)
+{
+    FLT_TYPE num = 0;
+    if (cpu->Pop1FloatNumber(&num)) return CPU_EMPTY_STACK;
+
+    return cpu->PushFloatNumber((num < 0) ? -num : num);
+}
+
+//------------------------------------------------------------------------------
+
+static int HostExp (CPU* cpu, void*)
+{
+    FLT_TYPE num = 0;
+    if (cpu->Pop1FloatNumber(&num)) return CPU_EMPTY_STACK;
+
+    return cpu->PushFloatNumber(exp(num));
+}
+
+//------------------------------------------------------------------------------
+
+static int HostFloor (CPU* cpu, void*)
+{
+    FLT_TYPE num = 0;
+    if (cpu->Pop1FloatNumber(&num)) return CPU_EMPTY_STACK;
+
+    return cpu->PushFloatNumber(floor(num));
+}
+
+//------------------------------------------------------------------------------
+
+static int HostLog (CPU* cpu, void*)
+{
+    FLT_TYPE num = 0;
+    if (cpu->Pop1FloatNumber(&num) || (num <= 0)) return CPU_NOT_OK;
+
+    return cpu->PushFloatNumber(log(num));
+}
+
+//------------------------------------------------------------------------------
+
+static int HostPow (CPU* cpu, void*)
+{
+    FLT_TYPE power = 0;
+    FLT_TYPE base  = 0;
+    if (cpu->Pop1FloatNumber(&power) || cpu->Pop1FloatNumber(&base)) return CPU_EMPTY_STACK;
+
+    return cpu->PushFloatNumber(pow(base, power));
+}
+
+//------------------------------------------------------------------------------
+
+template <typename TYPE>
+static void PrintNumber (FILE* out, int mode, const TYPE& value)
+{
+    switch (mode)
+    {
+    case IO_FAST:
+
+        TypePrintFast(out, value);
+        break;
+
+    case IO_BINARY:
+
+        fwrite(&value, sizeof(TYPE), 1, out);
+        break;
+
+    default:
+
+        fprintf(out, "OUT: ");
+        TypePrint(out, value);
+        fprintf(out, "\n");
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+// pushq and popq move floats through RAM, push and pop move ints
+static size_t NumberSize (int cmd_code)
+{
+    int cmd = cmd_code & ~(NUM_FLAG | REG_FLAG | PTR_FLAG);
+
+    return ((cmd == CMD_PUSHQ) || (cmd == CMD_POPQ)) ? sizeof(FLT_TYPE) : sizeof(INT_TYPE);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename TYPE>
+static bool ScanNumber (FILE* in, FILE* out, int mode, TYPE* value)
+{
+    switch (mode)
+    {
+    case IO_FAST:   return TypeScanFast(in, value);
+    case IO_BINARY: return (fread(value, sizeof(TYPE), 1, in) == 1);
+
+    default:
+
+        fprintf(out, "IN: ");
+        return TypeScan(in, value);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+template <typename TYPE>
+bool CPU::CanPush (const Stack<TYPE>& stack) const
+{
+    return (mem_limit_ == 0) || (stack.getSize() + 1 < stack.getCapacity()) ||
+           (getHeapSize() + stack.getCapacity() * sizeof(TYPE) <= mem_limit_);
+}
+
+//------------------------------------------------------------------------------
+
+template <typename TYPE>
+int CPU::Input (TYPE* value, char type)
+{
+    if (replay_ != nullptr)
+    {
+        size_t step  = 0;
+        int    shift = 0;
+        int    c     = 0;
+
+        do
+        {
+            if ((c = getc(replay_)) == EOF) return CPU_REPLAY_MISMATCH;
+
+            step  |= (size_t)(c & 0x7F) << shift;
+            shift += 7;
+        }
+        while (c & 0x80);
+
+        if ((step != steps_) || (getc(replay_) != type) || (fread(value, sizeof(TYPE), 1, replay_) != 1)) return CPU_REPLAY_MISMATCH;
+    }
+    else if (! ScanNumber(in_, out_, io_mode_, value)) return CPU_INCORRECT_INPUT;
+
+    if (record_ != nullptr)
+    {
+        unsigned char entry[16 + sizeof(TYPE)] = {};
+        size_t len = 0;
+
+        for (size_t step = steps_; ; step >>= 7)
+        {
+            entry[len++] = (step & 0x7F) | ((step >> 7) ? 0x80 : 0);
+            if ((step >> 7) == 0) break;
+        }
+
+        entry[len++] = type;
+        memcpy(entry + len, value, sizeof(TYPE));
+        len += sizeof(TYPE);
+
+        // one write per number, so that numbers of guest threads are not mixed
+        fwrite(entry, 1, len, record_);
+    }
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+std::mutex               CPU::cpus_lock_;
+std::unordered_set<CPU*> CPU::cpus_;
+
+//------------------------------------------------------------------------------
+
+HostFunction CPU::host_funcs_[HOST_FUNCS_NUM] =
+{
+    { HostAbs   },
+    { HostExp   },
+    { HostFloor },
+    { HostLog   },
+    { HostPow   },
+};
+
+//------------------------------------------------------------------------------
+
 CPU::CPU (char* filename) : 
     bcode_      (filename),
     filename_   (filename),
@@ -20,626 +195,2371 @@ CPU::CPU (char* filename) :
     stkCPU_PTR_ ((char*)"stkCPU_PTR_", DEFAULT_STACK_CAPACITY),
     state_      (CPU_OK)
 {
+    Track(true);
+
+    Init();
+
+    // the name is saved in snapshots, a cut one would restore another program
+    if (strlen(filename) >= MAX_NAME_LEN) Fault(CPU_TOO_LONG_NAME, __FILE__, __LINE__, __FUNC_NAME__, nullptr);
+}
+
+//------------------------------------------------------------------------------
+
+CPU::CPU () :
+    filename_   (progname_),
+    stkCPU_INT_ ((char*)"stkCPU_INT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_FLT_ ((char*)"stkCPU_FLT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_PTR_ ((char*)"stkCPU_PTR_", DEFAULT_STACK_CAPACITY),
+    state_      (CPU_OK)
+{
+    Track(true);
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        registers_[i] = POISON<REG_TYPE>;
+    }
+
+    if (AllocRAM() != CPU_OK) Fault(CPU_NO_MEMORY, __FILE__, __LINE__, __FUNC_NAME__, nullptr);
+}
+
+//------------------------------------------------------------------------------
+
+CPU::CPU (const char* data, size_t size, const char* name) :
+    bcode_      (data, size),
+    filename_   (progname_),
+    stkCPU_INT_ ((char*)"stkCPU_INT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_FLT_ ((char*)"stkCPU_FLT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_PTR_ ((char*)"stkCPU_PTR_", DEFAULT_STACK_CAPACITY),
+    state_      (CPU_OK)
+{
+    Track(true);
+
+    bool too_long = (strlen(name) >= MAX_NAME_LEN);
+    if (! too_long) strcpy(progname_, name);
+
+    Init();
+
+    if (too_long) Fault(CPU_TOO_LONG_NAME, __FILE__, __LINE__, __FUNC_NAME__, nullptr);
+}
+
+//------------------------------------------------------------------------------
+
+CPU::CPU (std::shared_ptr<const ProgramImage> image, const char* name) :
+    filename_   (progname_),
+    stkCPU_INT_ ((char*)"stkCPU_INT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_FLT_ ((char*)"stkCPU_FLT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_PTR_ ((char*)"stkCPU_PTR_", DEFAULT_STACK_CAPACITY),
+    state_      (CPU_OK)
+{
+    Track(true);
+
+    if (AllocRAM() != CPU_OK) Fault(CPU_NO_MEMORY, __FILE__, __LINE__, __FUNC_NAME__, nullptr);
+
+    Load(image, name);
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Init ()
+{
+    CPU_ASSERTOK((AllocRAM() != CPU_OK), CPU_NO_MEMORY, nullptr);
+
+    return Reset();
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Reset ()
+{
+    state_       = CPU_OK;
+    fault_       = {};
+    steps_       = 0;
+    entry_       = 0;
+    screens_num_ = 0;
+
+    deterministic_ = true;
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        registers_[i] = POISON<REG_TYPE>;
+    }
+
+    CPU_ASSERTOK((bcode_.data_ == nullptr), CPU_EMPTY_PROGRAM, nullptr);
+
+    // the code of an image is checked and cut once for all cpus
+    if (image_ == nullptr)
+    {
+        CPU_ASSERTOK((GetBinVariant(bcode_.data_, bcode_.size_) != NUM_VARIANT), CPU_WRONG_NUM_VARIANT, nullptr);
+        bcode_.size_ = CutBinHeader(bcode_.data_, bcode_.size_);
+    }
+    bcode_.ptr_ = 0;
+
+    // modules are next to the program, the name of the program is cut later by screen
+    modules_.clear();
+
+    const char* slash = strrchr(filename_, '/');
+    size_t      len   = (slash == nullptr) ? 0 : std::min((size_t)(slash - filename_), MAX_NAME_LEN - 1);
+
+    if (slash == nullptr) strcpy(moddir_, ".");
+    else                  { memcpy(moddir_, filename_, len); moddir_[len] = '\0'; }
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+CPU::CPU (CPU* parent, ptr_t entry) :
+    filename_   (parent->filename_),
+    stkCPU_INT_ ((char*)"stkCPU_INT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_FLT_ ((char*)"stkCPU_FLT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_PTR_ ((char*)"stkCPU_PTR_", DEFAULT_STACK_CAPACITY),
+    parent_     (parent),
+    entry_      (entry),
+    state_      (CPU_OK)
+{
+    Track(true);
+
+    // the code is borrowed from the parent, not constructed BinCode never frees it
+    bcode_.data_ = parent->bcode_.data_;
+    bcode_.size_ = parent->bcode_.size_;
+    bcode_.ptr_  = entry;
+
+    log_ = parent->log_;
+    in_  = parent->in_;
+    out_ = parent->out_;
+
+    io_mode_ = parent->io_mode_;
+    record_  = parent->record_;
+    replay_  = parent->replay_;
+
+    mem_limit_ = parent->mem_limit_;
+
+    strcpy(sandbox_, parent->sandbox_);
+    strcpy(moddir_,  parent->moddir_);
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        registers_[i] = parent->registers_[i];
+    }
+
+    RAM_   = parent->RAM_;
+    dirty_ = parent->dirty_;
+    share_ = parent->share_;
+}
+
+//------------------------------------------------------------------------------
+
+CPU::~CPU ()
+{
+    assert(this != nullptr);
+
+    if (state_ == CPU_DESTRUCTED) return;
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        if (threads_[i].cpu != nullptr) Join(i);
+    }
+
+    aio_.Clear();
+
     for (int i = 0; i < REG_NUM; ++i)
     {
-        registers_[i] = POISON<FLT_TYPE>;
+        registers_[i] = POISON<REG_TYPE>;
+    }
+
+    if (parent_ == nullptr)
+    {
+        FreeRAM();
+
+        if (record_ != nullptr) fclose(record_);
+        if (replay_ != nullptr) fclose(replay_);
+
+#ifndef NO_SFML
+        CloseWindow();
+#endif
+    }
+
+    Thaw();
+    Track(false);
+
+    state_ = CPU_DESTRUCTED;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Load (const char* data, size_t size, const char* name)
+{
+    CPU_ASSERTOK((this == nullptr),                   CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr),                   CPU_NO_MEMORY,           nullptr);
+    CPU_ASSERTOK(((data == nullptr) || (size == 0)), CPU_EMPTY_PROGRAM,       nullptr);
+    CPU_ASSERTOK((name == nullptr),                   CPU_NULL_INPUT_FILENAME, nullptr);
+    CPU_ASSERTOK((strlen(name) >= MAX_NAME_LEN),      CPU_TOO_LONG_NAME,       nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        if (threads_[i].cpu != nullptr) Join(i);
+    }
+
+    aio_.Clear();
+
+    CPU_ASSERTOK((bcode_.Load(data, size) != STR_OK), CPU_NO_MEMORY, nullptr);
+    image_ = nullptr;
+
+    strcpy(progname_, name);
+    filename_ = progname_;
+
+    Thaw();
+    ClearRAM();
+    memset(dirty_, 0, CHECK_PAGES_NUM);
+
+    stkCPU_INT_.Clean();
+    stkCPU_FLT_.Clean();
+    stkCPU_PTR_.Clean();
+
+    return Reset();
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Load (std::shared_ptr<const ProgramImage> image, const char* name)
+{
+    CPU_ASSERTOK((this == nullptr),                                CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr),                                CPU_NO_MEMORY,           nullptr);
+    CPU_ASSERTOK(((image == nullptr) || (image->code.size_ == 0)), CPU_EMPTY_PROGRAM,       nullptr);
+    CPU_ASSERTOK((image->variant != NUM_VARIANT),                  CPU_WRONG_NUM_VARIANT,   nullptr);
+    CPU_ASSERTOK((name == nullptr),                                CPU_NULL_INPUT_FILENAME, nullptr);
+    CPU_ASSERTOK((strlen(name) >= MAX_NAME_LEN),                   CPU_TOO_LONG_NAME,       nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        if (threads_[i].cpu != nullptr) Join(i);
+    }
+
+    aio_.Clear();
+
+    // nothing writes to the code of an image, lcall copies it before loading a module
+    bcode_.Borrow(image->code.data_, image->code.size_);
+    image_ = image;
+
+    strcpy(progname_, name);
+    filename_ = progname_;
+
+    Thaw();
+    ClearRAM();
+    memset(dirty_, 0, CHECK_PAGES_NUM);
+
+    stkCPU_INT_.Clean();
+    stkCPU_FLT_.Clean();
+    stkCPU_PTR_.Clean();
+
+    return Reset();
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Save (const char* filename)
+{
+    CPU_ASSERTOK((this == nullptr),     CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((filename == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr),     CPU_NO_MEMORY,           nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        CPU_ASSERTOK((threads_[i].cpu != nullptr), CPU_THREADS_RUNNING, nullptr);
+    }
+
+    aio_.Drain();
+
+    SnapHeader header = {};
+    MakeSnapHeader(&header, SNAP_SIGNATURE);
+
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t data = sizeof(SnapHeader) + bcode_.size_ + header.stack_size[0] * sizeof(INT_TYPE)
+                                                    + header.stack_size[1] * sizeof(FLT_TYPE)
+                                                    + header.stack_size[2] * sizeof(PTR_TYPE);
+    header.ram_offset = (data + page - 1) / page * page;
+
+    FILE* fp = fopen(filename, "wb");
+    CPU_ASSERTOK((fp == nullptr), CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    fwrite(&header, sizeof(SnapHeader), 1, fp);
+    WriteState(fp);
+
+    // zero pages of RAM are not written, they stay holes in the file
+    fseek(fp, header.ram_offset, SEEK_SET);
+    for (size_t addr = 0; addr < RAM_SIZE; addr += page)
+    {
+        size_t len = (RAM_SIZE - addr < page) ? RAM_SIZE - addr : page;
+
+        bool zero = (RAM_[addr] == 0) && (memcmp(RAM_ + addr, RAM_ + addr + 1, len - 1) == 0);
+        if (zero)
+            fseek(fp, len, SEEK_CUR);
+        else
+            fwrite(RAM_ + addr, 1, len, fp);
+    }
+
+    fflush(fp);
+    bool err = ferror(fp) || (ftruncate(fileno(fp), header.ram_offset + RAM_SIZE) != 0);
+    fclose(fp);
+
+    CPU_ASSERTOK(err, CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Restore (const char* filename)
+{
+    CPU_ASSERTOK((this == nullptr),     CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((filename == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        if (threads_[i].cpu != nullptr) Join(i);
     }
 
-    RAM_ = new char[RAM_SIZE] {};
-    CPU_ASSERTOK((RAM_ == nullptr), CPU_NO_MEMORY, nullptr);
-}
+    aio_.Clear();
+
+    int fd = open(filename, O_RDONLY);
+    CPU_ASSERTOK((fd < 0), CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    struct stat info = {};
+    fstat(fd, &info);
+    size_t size = info.st_size;
+
+    if (size < sizeof(SnapHeader)) close(fd);
+    CPU_ASSERTOK((size < sizeof(SnapHeader)), CPU_WRONG_SNAPSHOT, nullptr);
+
+    char* map = (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+    CPU_ASSERTOK((map == MAP_FAILED), CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    SnapHeader header = {};
+    memcpy(&header, map, sizeof(SnapHeader));
+
+    // every part is checked against the file first, so that the sum can not overflow
+    bool fits = (header.code_size     <= size)                    &&
+                (header.stack_size[0] <= size / sizeof(INT_TYPE)) &&
+                (header.stack_size[1] <= size / sizeof(FLT_TYPE)) &&
+                (header.stack_size[2] <= size / sizeof(PTR_TYPE)) &&
+                (size >= RAM_SIZE);
+
+    size_t data = (! fits) ? 0 : sizeof(SnapHeader) + header.code_size + header.stack_size[0] * sizeof(INT_TYPE)
+                                                                       + header.stack_size[1] * sizeof(FLT_TYPE)
+                                                                       + header.stack_size[2] * sizeof(PTR_TYPE);
+
+    bool wrong = (! fits)                                                                    ||
+                 (memcmp(header.signature, SNAP_SIGNATURE, sizeof(header.signature)) != 0) ||
+                 (header.version    != SNAP_VERSION)                                         ||
+                 (header.variant    != NUM_VARIANT)                                          ||
+                 (header.code_size  == 0)                                                    ||
+                 (header.ptr         > header.code_size)                                     ||
+                 (header.ram_offset  < data)                                                 ||
+                 (header.ram_offset  > size - RAM_SIZE)                                      ||
+                 (memchr(header.progname, '\0', MAX_NAME_LEN) == nullptr)                   ||
+                 (memchr(header.moddir,   '\0', MAX_NAME_LEN) == nullptr);
+
+    if (wrong) munmap(map, size);
+    CPU_ASSERTOK(wrong, CPU_WRONG_SNAPSHOT, nullptr);
+
+    char* ptr = map + sizeof(SnapHeader);
+
+    bool no_memory = (bcode_.Load(ptr, header.code_size) != STR_OK);
+
+    if (no_memory) munmap(map, size);
+    CPU_ASSERTOK(no_memory, CPU_NO_MEMORY, nullptr);
+    ptr += header.code_size;
+
+    image_ = nullptr;
+    modules_.clear();
+
+    stkCPU_INT_.Clean();
+    stkCPU_FLT_.Clean();
+    stkCPU_PTR_.Clean();
+
+    INT_TYPE num_int = 0;
+    FLT_TYPE num_flt = 0;
+    PTR_TYPE num_ptr = 0;
+
+    for (size_t i = 0; i < header.stack_size[0]; ++i, ptr += sizeof(INT_TYPE)) { memcpy(&num_int, ptr, sizeof(INT_TYPE)); stkCPU_INT_.Push(num_int); }
+    for (size_t i = 0; i < header.stack_size[1]; ++i, ptr += sizeof(FLT_TYPE)) { memcpy(&num_flt, ptr, sizeof(FLT_TYPE)); stkCPU_FLT_.Push(num_flt); }
+    for (size_t i = 0; i < header.stack_size[2]; ++i, ptr += sizeof(PTR_TYPE)) { memcpy(&num_ptr, ptr, sizeof(PTR_TYPE)); stkCPU_PTR_.Push(num_ptr); }
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        registers_[i] = header.registers[i];
+    }
+
+    Thaw();
+    FreeRAM();
+    map_      = map;
+    map_size_ = size;
+    RAM_      = map + header.ram_offset;
+
+    // the next checkpoint has to keep all RAM
+    memset(dirty_, 1, CHECK_PAGES_NUM);
+
+    bcode_.ptr_  = header.ptr;
+    entry_       = header.entry;
+    steps_       = header.steps;
+    screens_num_ = header.screens_num;
+
+    RestoreNames(&header);
+
+    state_ = CPU_OK;
+    fault_ = {};
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::FreeRAM ()
+{
+    if (share_ != nullptr)
+    {
+        __atomic_store_n(&share_->done, 1, __ATOMIC_RELEASE);
+        share_ = nullptr;
+    }
+
+    if (map_ != nullptr)
+    {
+        munmap(map_, map_size_);
+        map_      = nullptr;
+        map_size_ = 0;
+    }
+
+    RAM_      = nullptr;
+    ram_anon_ = false;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::AllocRAM ()
+{
+    char* map = (char*)mmap(nullptr, RAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (map == MAP_FAILED) return CPU_NO_MEMORY;
+
+    map_      = map;
+    map_size_ = RAM_SIZE;
+    RAM_      = map;
+    ram_anon_ = true;
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::ClearRAM ()
+{
+    // files of snapshots and shared RAM would give their own pages back, so they are filled
+    if (ram_anon_ && (madvise(RAM_, RAM_SIZE, MADV_DONTNEED) == 0)) return;
+
+    memset(RAM_, 0, RAM_SIZE);
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Checkpoint (const char* filename)
+{
+    CPU_ASSERTOK((this == nullptr),     CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((filename == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr),     CPU_NO_MEMORY,           nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        CPU_ASSERTOK((threads_[i].cpu != nullptr), CPU_THREADS_RUNNING, nullptr);
+    }
+
+    aio_.Drain();
+
+    CheckHeader header = {};
+    MakeSnapHeader(&header.state, CHECK_SIGNATURE);
+
+    for (size_t i = 0; i < CHECK_PAGES_NUM; ++i)
+    {
+        if (dirty_[i]) ++header.pages_num;
+    }
+
+    FILE* fp = fopen(filename, "ab");
+    CPU_ASSERTOK((fp == nullptr), CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    fwrite(&header, sizeof(CheckHeader), 1, fp);
+    WriteState(fp);
+
+    for (size_t i = 0; i < CHECK_PAGES_NUM; ++i)
+    {
+        if (! dirty_[i]) continue;
+
+        fwrite(&i,                           sizeof(size_t),  1, fp);
+        fwrite(RAM_ + i * CHECK_PAGE_SIZE, CHECK_PAGE_SIZE, 1, fp);
+    }
+
+    bool err = (fflush(fp) != 0) || ferror(fp);
+    fclose(fp);
+
+    CPU_ASSERTOK(err, CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    memset(dirty_, 0, CHECK_PAGES_NUM);
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::RestoreCheckpoint (const char* filename)
+{
+    CPU_ASSERTOK((this == nullptr),     CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((filename == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr),     CPU_NO_MEMORY,           nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        if (threads_[i].cpu != nullptr) Join(i);
+    }
+
+    aio_.Clear();
+
+    FILE* fp = fopen(filename, "rb");
+    CPU_ASSERTOK((fp == nullptr), CPU_SNAPSHOT_FILE_ERROR, nullptr);
+
+    struct stat info = {};
+    fstat(fileno(fp), &info);
+    size_t size = info.st_size;
+
+    Thaw();
+    ClearRAM();
+
+    CheckHeader header  = {};
+    bool        wrong   = false;
+    size_t      records = 0;
+
+    while ((! wrong) && (fread(&header, sizeof(CheckHeader), 1, fp) == 1))
+    {
+        SnapHeader& state = header.state;
+
+        wrong = (memcmp(state.signature, CHECK_SIGNATURE, sizeof(state.signature)) != 0) ||
+                (state.version   != SNAP_VERSION)                                         ||
+                (state.variant   != NUM_VARIANT)                                          ||
+                (state.code_size == 0)                                                    ||
+                (state.code_size  > size)                                                 ||
+                (state.ptr        > state.code_size)                                      ||
+                (header.pages_num > CHECK_PAGES_NUM)                                      ||
+                (memchr(state.progname, '\0', MAX_NAME_LEN) == nullptr)                  ||
+                (memchr(state.moddir,   '\0', MAX_NAME_LEN) == nullptr);
+        if (wrong) break;
+
+        char* code = (char*)calloc(state.code_size, 1);
+        wrong = (code == nullptr) || (fread(code, 1, state.code_size, fp) != state.code_size) || (bcode_.Load(code, state.code_size) != STR_OK);
+        free(code);
+
+        if (! wrong) image_ = nullptr;
+        modules_.clear();
+
+        stkCPU_INT_.Clean();
+        stkCPU_FLT_.Clean();
+        stkCPU_PTR_.Clean();
+
+        INT_TYPE num_int = 0;
+        FLT_TYPE num_flt = 0;
+        PTR_TYPE num_ptr = 0;
+
+        for (size_t i = 0; (! wrong) && (i < state.stack_size[0]); ++i) { wrong = (fread(&num_int, sizeof(INT_TYPE), 1, fp) != 1); stkCPU_INT_.Push(num_int); }
+        for (size_t i = 0; (! wrong) && (i < state.stack_size[1]); ++i) { wrong = (fread(&num_flt, sizeof(FLT_TYPE), 1, fp) != 1); stkCPU_FLT_.Push(num_flt); }
+        for (size_t i = 0; (! wrong) && (i < state.stack_size[2]); ++i) { wrong = (fread(&num_ptr, sizeof(PTR_TYPE), 1, fp) != 1); stkCPU_PTR_.Push(num_ptr); }
+
+        for (size_t i = 0; (! wrong) && (i < header.pages_num); ++i)
+        {
+            size_t page = 0;
+            wrong = (fread(&page, sizeof(size_t), 1, fp) != 1) || (page >= CHECK_PAGES_NUM) ||
+                    (fread(RAM_ + page * CHECK_PAGE_SIZE, CHECK_PAGE_SIZE, 1, fp) != 1);
+        }
+
+        ++records;
+    }
+
+    fclose(fp);
+
+    CPU_ASSERTOK((wrong || (records == 0)), CPU_WRONG_SNAPSHOT, nullptr);
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        registers_[i] = header.state.registers[i];
+    }
+
+    bcode_.ptr_  = header.state.ptr;
+    entry_       = header.state.entry;
+    steps_       = header.state.steps;
+    screens_num_ = header.state.screens_num;
+
+    RestoreNames(&header.state);
+
+    state_ = CPU_OK;
+    fault_ = {};
+
+    // the log keeps this state, the next checkpoint continues it
+    memset(dirty_, 0, CHECK_PAGES_NUM);
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::MakeSnapHeader (SnapHeader* header, const char* signature)
+{
+    assert(header    != nullptr);
+    assert(signature != nullptr);
+
+    memcpy(header->signature, signature, sizeof(header->signature));
+    header->version     = SNAP_VERSION;
+    header->variant     = NUM_VARIANT;
+    header->code_size   = bcode_.size_;
+    header->ptr         = bcode_.ptr_;
+    header->entry       = entry_;
+    header->steps       = steps_;
+    header->screens_num = screens_num_;
+
+    header->stack_size[0] = stkCPU_INT_.getSize();
+    header->stack_size[1] = stkCPU_FLT_.getSize();
+    header->stack_size[2] = stkCPU_PTR_.getSize();
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        header->registers[i] = registers_[i];
+    }
+
+    // a restored snapshot is checked for the terminators, so they are always written
+    strncpy(header->progname, filename_, MAX_NAME_LEN - 1);
+    strncpy(header->moddir,   moddir_,   MAX_NAME_LEN - 1);
+    header->progname[MAX_NAME_LEN - 1] = '\0';
+    header->moddir  [MAX_NAME_LEN - 1] = '\0';
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::RestoreNames (const SnapHeader* header)
+{
+    assert(header != nullptr);
+
+    // filename_ may point to the name of another program, the saved one is copied
+    strcpy(progname_, header->progname);
+    strcpy(moddir_,   header->moddir);
+    filename_ = progname_;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::WriteState (FILE* fp)
+{
+    assert(fp != nullptr);
+
+    fwrite(bcode_.data_, 1, bcode_.size_, fp);
+
+    for (size_t i = 0; i < stkCPU_INT_.getSize(); ++i) fwrite(&stkCPU_INT_[i], sizeof(INT_TYPE), 1, fp);
+    for (size_t i = 0; i < stkCPU_FLT_.getSize(); ++i) fwrite(&stkCPU_FLT_[i], sizeof(FLT_TYPE), 1, fp);
+    for (size_t i = 0; i < stkCPU_PTR_.getSize(); ++i) fwrite(&stkCPU_PTR_[i], sizeof(PTR_TYPE), 1, fp);
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Share (const char* name)
+{
+    CPU_ASSERTOK((this == nullptr), CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((name == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr), CPU_NO_MEMORY,           nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        CPU_ASSERTOK((threads_[i].cpu != nullptr), CPU_THREADS_RUNNING, nullptr);
+    }
+
+    aio_.Drain();
+
+    int fd = (name[0] == '/') ? shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644)
+                              : open    (name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CPU_ASSERTOK((fd < 0), CPU_SHARE_FILE_ERROR, nullptr);
+
+    size_t size = SHARE_RAM_OFFSET + RAM_SIZE;
+
+    char* map = (ftruncate(fd, size) != 0) ? (char*)MAP_FAILED : (char*)mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    CPU_ASSERTOK((map == MAP_FAILED), CPU_SHARE_FILE_ERROR, nullptr);
+
+    ShareHeader* header = (ShareHeader*)map;
+    memcpy(header->signature, SHARE_SIGNATURE, sizeof(header->signature));
+    header->version   = SHARE_VERSION;
+    header->variant   = NUM_VARIANT;
+    header->ram_size  = RAM_SIZE;
+    header->page_size = CHECK_PAGE_SIZE;
+
+    // zero pages stay holes in the file
+    for (size_t addr = 0; addr < RAM_SIZE; addr += CHECK_PAGE_SIZE)
+    {
+        bool zero = (RAM_[addr] == 0) && (memcmp(RAM_ + addr, RAM_ + addr + 1, CHECK_PAGE_SIZE - 1) == 0);
+        if (! zero) memcpy(map + SHARE_RAM_OFFSET + addr, RAM_ + addr, CHECK_PAGE_SIZE);
+    }
+
+    Thaw();
+    FreeRAM();
+    map_      = map;
+    map_size_ = size;
+    RAM_      = map + SHARE_RAM_OFFSET;
+    share_    = header;
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::MarkDirty (ptr_t addr, size_t len)
+{
+    if (len == 0) return;
+
+    for (size_t page = addr / CHECK_PAGE_SIZE; page <= (addr + len - 1) / CHECK_PAGE_SIZE; ++page)
+    {
+        dirty_[page] = 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::OpenGuestFile (ptr_t name, int flags, int* fd)
+{
+    assert(fd != nullptr);
+
+    if ((sandbox_[0] == '\0') || (name >= RAM_SIZE)) return CPU_FILE_NOT_ALLOWED;
+
+    size_t len = strnlen(RAM_ + name, RAM_SIZE - name);
+    if ((len == 0) || (len == RAM_SIZE - name) || (len >= MAX_NAME_LEN)) return CPU_FILE_NOT_ALLOWED;
+
+    char filename[MAX_NAME_LEN] = "";
+    memcpy(filename, RAM_ + name, len);
+
+    if (filename[0] == '/') return CPU_FILE_NOT_ALLOWED;
+
+    for (char* part = filename; part != nullptr; part = strchr(part, '/'))
+    {
+        if (*part == '/') ++part;
+        if ((strncmp(part, "..", 2) == 0) && ((part[2] == '/') || (part[2] == '\0'))) return CPU_FILE_NOT_ALLOWED;
+    }
+
+    int dir = open(sandbox_, O_PATH | O_DIRECTORY);
+    if (dir < 0) return CPU_GUEST_FILE_ERROR;
+
+    // a symlink in any part of the path could lead out of the sandbox, none is followed
+    open_how how = {};
+    how.flags   = flags | O_NOFOLLOW;
+    how.mode    = (flags & O_CREAT) ? 0644 : 0;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_SYMLINKS | RESOLVE_NO_MAGICLINKS;
+
+    *fd = syscall(SYS_openat2, dir, filename, &how, sizeof(how));
+
+    // kernels before 5.6 have no openat2, the directories are opened one by one then
+    if ((*fd < 0) && (errno == ENOSYS))
+    {
+        char* part = filename;
+        for (char* slash = strchr(part, '/'); (dir >= 0) && (slash != nullptr); slash = strchr(part, '/'))
+        {
+            *slash = '\0';
+
+            int next = openat(dir, part, O_PATH | O_DIRECTORY | O_NOFOLLOW);
+            close(dir);
+            dir = next;
+
+            part = slash + 1;
+        }
+
+        *fd = (dir < 0) ? -1 : openat(dir, part, flags | O_NOFOLLOW, 0644);
+    }
+
+    if (dir >= 0) close(dir);
+    if (*fd < 0) return CPU_GUEST_FILE_ERROR;
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::LinkModule (ptr_t stub, ptr_t* target)
+{
+    assert(target != nullptr);
+
+    if (parent_ != nullptr) return CPU_THREADS_RUNNING;
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        if (threads_[i].cpu != nullptr) return CPU_THREADS_RUNNING;
+    }
+
+    std::string name(bcode_.data_ + stub + POINTER_SIZE + 1, (unsigned char)bcode_.data_[stub + POINTER_SIZE]);
+
+    // a module is a file of the module directory, the name can not lead out of it
+    bool wrong = name.empty() || (name.find('/') != std::string::npos) || (name.find('\0') != std::string::npos) ||
+                 (name.find("..") != std::string::npos);
+    if (wrong) return CPU_WRONG_MODULE_NAME;
+
+    // the code of an image is shared with other cpus, the module is loaded to a copy
+    if (image_ != nullptr)
+    {
+        size_t ptr = bcode_.ptr_;
+
+        if (bcode_.Load(bcode_.data_, bcode_.size_) != STR_OK) return CPU_NO_MEMORY;
+        image_ = nullptr;
+
+        bcode_.ptr_ = ptr;
+    }
+
+    auto module = modules_.find(name);
+    if (module == modules_.end())
+    {
+        char path[2 * MAX_NAME_LEN] = "";
+        snprintf(path, sizeof(path), "%s/%s%s", moddir_, name.c_str(), MODULE_TYPE);
+
+        std::shared_ptr<const ProgramImage> image = GetImage(path);
+        if ((image == nullptr) || (image->variant != NUM_VARIANT) || (image->code.size_ == 0)) return CPU_MODULE_NOT_FOUND;
+
+        const BinCode& code = image->code;
+
+        ptr_t base = bcode_.size_;
+        if (bcode_.Append(code.data_, code.size_) != STR_OK) return CPU_NO_MEMORY;
+
+        if (! RelocateModule(bcode_.data_ + base, code.size_, base))
+        {
+            bcode_.size_ = base;
+            return CPU_MODULE_NOT_FOUND;
+        }
+
+        module = modules_.emplace(name, base).first;
+
+        // the result depends on the module file now
+        deterministic_ = false;
+    }
+
+    *target = module->second;
+    memcpy(bcode_.data_ + stub, target, POINTER_SIZE);
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Clone (CPU** clone)
+{
+    CPU_ASSERTOK((this == nullptr),  CPU_NULL_INPUT_CPU_PTR, nullptr);
+    CPU_ASSERTOK((clone == nullptr), CPU_NULL_INPUT_CPU_PTR, nullptr);
+    CPU_ASSERTOK((RAM_ == nullptr),  CPU_NO_MEMORY,          nullptr);
+
+    for (int i = 0; i < MAX_THREADS; ++i)
+    {
+        CPU_ASSERTOK((threads_[i].cpu != nullptr), CPU_THREADS_RUNNING, nullptr);
+    }
+
+    aio_.Drain();
+
+    CPU_ASSERTOK((share_ != nullptr), CPU_SHARED_RAM, nullptr);
+
+    int err = Freeze();
+    if (err) return err;
+
+    *clone = new (std::nothrow) CPU(*this, image_fd_);
+    CPU_ASSERTOK((*clone == nullptr), CPU_NO_MEMORY, nullptr);
+
+    if ((*clone)->RAM_ == nullptr)
+    {
+        delete *clone;
+        *clone = nullptr;
+    }
+    CPU_ASSERTOK((*clone == nullptr), CPU_NO_MEMORY, nullptr);
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+CPU::CPU (const CPU& origin, int image) :
+    filename_   (progname_),
+    stkCPU_INT_ ((char*)"stkCPU_INT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_FLT_ ((char*)"stkCPU_FLT_", DEFAULT_STACK_CAPACITY),
+    stkCPU_PTR_ ((char*)"stkCPU_PTR_", DEFAULT_STACK_CAPACITY),
+    entry_      (origin.entry_),
+    state_      (origin.state_)
+{
+    Track(true);
+
+    strncpy(progname_, origin.filename_, MAX_NAME_LEN - 1);
+
+    // clones of a program loaded from an image share its code, a linked program has its own copy
+    if (origin.image_ != nullptr)
+    {
+        bcode_.Borrow(origin.image_->code.data_, origin.image_->code.size_);
+        image_ = origin.image_;
+    }
+    else bcode_.Load(origin.bcode_.data_, origin.bcode_.size_);
+
+    bcode_.ptr_  = origin.bcode_.ptr_;
+    steps_       = origin.steps_;
+    fault_       = origin.fault_;
+    screens_num_ = origin.screens_num_;
+    log_         = origin.log_;
+    in_          = origin.in_;
+    out_         = origin.out_;
+    io_mode_     = origin.io_mode_;
+    headless_    = origin.headless_;
+    strcpy(scrname_, origin.scrname_);
+    screen_func_ = origin.screen_func_;
+    screen_data_ = origin.screen_data_;
+
+    screen_format_ = origin.screen_format_;
+    encoder_.setThreads(origin.encoder_.getThreads());
+    mem_limit_   = origin.mem_limit_;
+
+    strcpy(sandbox_, origin.sandbox_);
+    strcpy(moddir_,  origin.moddir_);
+
+    modules_ = origin.modules_;
+
+    deterministic_ = origin.deterministic_;
+
+    for (int i = 0; i < REG_NUM; ++i)
+    {
+        registers_[i] = origin.registers_[i];
+    }
+
+    for (size_t i = 0; i < origin.stkCPU_INT_.getSize(); ++i) stkCPU_INT_.Push(origin.stkCPU_INT_[i]);
+    for (size_t i = 0; i < origin.stkCPU_FLT_.getSize(); ++i) stkCPU_FLT_.Push(origin.stkCPU_FLT_[i]);
+    for (size_t i = 0; i < origin.stkCPU_PTR_.getSize(); ++i) stkCPU_PTR_.Push(origin.stkCPU_PTR_[i]);
+
+    char* map = (char*)mmap(nullptr, RAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, image, 0);
+    if (map == MAP_FAILED) return;
+
+    map_      = map;
+    map_size_ = RAM_SIZE;
+    RAM_      = map;
+
+    // the next checkpoint has to keep all RAM
+    memset(dirty_, 1, CHECK_PAGES_NUM);
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Freeze ()
+{
+    if (image_fd_ >= 0) return CPU_OK;
+
+    int fd = memfd_create("cpu_ram", 0);
+    CPU_ASSERTOK((fd < 0), CPU_NO_MEMORY, nullptr);
+
+    bool err = (ftruncate(fd, RAM_SIZE) != 0);
+
+    // zero pages stay holes in the memory file
+    size_t page = sysconf(_SC_PAGESIZE);
+    for (size_t addr = 0; (addr < RAM_SIZE) && (! err); addr += page)
+    {
+        size_t len = (RAM_SIZE - addr < page) ? RAM_SIZE - addr : page;
+
+        bool zero = (RAM_[addr] == 0) && (memcmp(RAM_ + addr, RAM_ + addr + 1, len - 1) == 0);
+        if (! zero) err = (pwrite(fd, RAM_ + addr, len, addr) != len);
+    }
+
+    char* map = (err) ? (char*)MAP_FAILED : (char*)mmap(nullptr, RAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    if (map == MAP_FAILED) close(fd);
+    CPU_ASSERTOK((map == MAP_FAILED), CPU_NO_MEMORY, nullptr);
+
+    FreeRAM();
+    map_      = map;
+    map_size_ = RAM_SIZE;
+    RAM_      = map;
+
+    image_fd_ = fd;
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::Thaw ()
+{
+    if (image_fd_ < 0) return;
+
+    close(image_fd_);
+    image_fd_ = -1;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Execute ()
+{
+    CPU_ASSERTOK((this == nullptr), CPU_NULL_INPUT_CPU_PTR, nullptr);
+
+    bcode_.ptr_ = entry_;
+
+    return Run();
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Run (size_t steps)
+{
+    CPU_ASSERTOK((this == nullptr), CPU_NULL_INPUT_CPU_PTR, nullptr);
+
+    int err = RunSteps(steps);
+    if (err == PROCESS_PAUSED) return err;
+
+    // screens still in the queue are saved before the program is done
+    CPU_ASSERTOK(((! encoder_.Drain()) && (err <= 0)), CPU_SCREEN_FAILED, this);
+
+    return err;
+}
+
+//------------------------------------------------------------------------------
+
+bool CPU::isWaiting () const
+{
+    return waiting_;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::setIONotify (AsyncNotify func, void* data)
+{
+    aio_.setNotify(func, data);
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::RunSteps (size_t steps)
+{
+    if (state_ != CPU_OK) return state_;
+
+    waiting_ = false;
+
+    // the next clone has to see the changes of RAM made by this run
+    Thaw();
+
+    int err = 0;
+
+    char reg_code = 0;
+
+    int width  = 0;
+    int height = 0;
+
+    PTR_TYPE ptr = POISON<PTR_TYPE>;
+
+    INT_TYPE num_int1 = POISON<INT_TYPE>;
+    INT_TYPE num_int2 = POISON<INT_TYPE>;
+
+    FLT_TYPE num_flt1 = POISON<FLT_TYPE>;
+    FLT_TYPE num_flt2 = POISON<FLT_TYPE>;
+
+    for (size_t step = 0; (steps == 0) || (step < steps); ++step)
+    {
+        if (bcode_.ptr_ >= bcode_.size_) return CPU_OK;
+
+        char cond = 0;
+
+        unsigned char cmd_code = bcode_.data_[bcode_.ptr_++];
+        ++steps_;
+
+        CPU_ASSERTOK(((stkCPU_INT_.getSize() >= MAX_STACK_SIZE) ||
+                      (stkCPU_FLT_.getSize() >= MAX_STACK_SIZE) ||
+                      (stkCPU_PTR_.getSize() >= MAX_STACK_SIZE)), CPU_STACK_OVERFLOW, this);
+
+        CPU_ASSERTOK(((mem_limit_ != 0) && (getHeapSize() > mem_limit_)), CPU_MEMORY_LIMIT, this);
+
+        switch (cmd_code)
+        {
+        case CMD_HLT:
+
+            // stay on hlt, so that the next run halts again
+            --bcode_.ptr_;
+            return PROCESS_HALT;
+            break;
+
+        case CMD_PUSH | NUM_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < NUMBER_INT_SIZE), CPU_NO_SPACE_FOR_NUMBER_INT, this);
+
+            num_int1 = *(INT_TYPE*)(bcode_.data_ + bcode_.ptr_);
+            CPU_PUSH(stkCPU_INT_, num_int1);
+            bcode_.ptr_ += NUMBER_INT_SIZE;
+            break;
+
+        case CMD_PUSHQ | NUM_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < NUMBER_FLT_SIZE), CPU_NO_SPACE_FOR_NUMBER_FLT, this);
+
+            num_flt1 = *(FLT_TYPE*)(bcode_.data_ + bcode_.ptr_);
+            CPU_PUSH(stkCPU_FLT_, num_flt1);
+            bcode_.ptr_ += NUMBER_FLT_SIZE;
+            break;
+
+        case CMD_PUSH  | REG_FLAG:
+        case CMD_PUSHQ | REG_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+            CPU_ASSERTOK(isPOISON(registers_[reg_code - 1]), CPU_EMPTY_REGISTER, this);
+
+            if (cmd_code == (CMD_PUSH | REG_FLAG))
+            {
+                CPU_PUSH(stkCPU_INT_, (INT_TYPE)registers_[reg_code - 1]);
+            }
+            else
+            if (cmd_code == (CMD_PUSHQ | REG_FLAG))
+            {
+                CPU_PUSH(stkCPU_FLT_, (FLT_TYPE)registers_[reg_code - 1]);
+            }
+            break;
+
+        case CMD_PUSH  | PTR_FLAG | NUM_FLAG:
+        case CMD_PUSHQ | PTR_FLAG | NUM_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+
+            ptr = *(PTR_TYPE*)(bcode_.data_ + bcode_.ptr_);
+            CPU_ASSERTOK((ptr + NumberSize(cmd_code) > RAM_SIZE), CPU_WRONG_ADDR, this);
+            bcode_.ptr_ += POINTER_SIZE;
+
+            if (cmd_code == (CMD_PUSH | PTR_FLAG | NUM_FLAG))
+            {
+                CPU_PUSH(stkCPU_INT_, *(INT_TYPE*)(RAM_ + ptr));
+            }
+            else
+            if (cmd_code == (CMD_PUSHQ | PTR_FLAG | NUM_FLAG))
+            {
+                CPU_PUSH(stkCPU_FLT_, *(FLT_TYPE*)(RAM_ + ptr));
+            }
+            break;
+
+        case CMD_PUSH  | PTR_FLAG | REG_FLAG:
+        case CMD_PUSHQ | PTR_FLAG | REG_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+            CPU_ASSERTOK(isPOISON(registers_[reg_code - 1]), CPU_EMPTY_REGISTER, this);
+
+            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
+            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
+            CPU_ASSERTOK((ptr + NumberSize(cmd_code) > RAM_SIZE), CPU_WRONG_ADDR, this);
+
+            if (cmd_code == (CMD_PUSH | PTR_FLAG | REG_FLAG))
+            {
+                CPU_PUSH(stkCPU_INT_, *(INT_TYPE*)(RAM_ + ptr));
+            }
+            else
+            if (cmd_code == (CMD_PUSHQ | PTR_FLAG | REG_FLAG))
+            {
+                CPU_PUSH(stkCPU_FLT_, *(FLT_TYPE*)(RAM_ + ptr));
+            }
+            break;
+
+        case CMD_PUSH  | PTR_FLAG | REG_FLAG | NUM_FLAG:
+        case CMD_PUSHQ | PTR_FLAG | REG_FLAG | NUM_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1 + NUMBER_INT_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+            CPU_ASSERTOK(isPOISON(registers_[reg_code - 1]), CPU_EMPTY_REGISTER, this);
+
+            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
+            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
+            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
+            
+            ptr += *(INT_TYPE*)(bcode_.data_ + bcode_.ptr_);
+            CPU_ASSERTOK((ptr + NumberSize(cmd_code) > RAM_SIZE), CPU_WRONG_ADDR, this);
+            bcode_.ptr_ += NUMBER_INT_SIZE;
+
+            if (cmd_code == (CMD_PUSH | PTR_FLAG | NUM_FLAG | REG_FLAG))
+            {
+                CPU_PUSH(stkCPU_INT_, *(INT_TYPE*)(RAM_ + ptr));
+            }
+            else
+            if (cmd_code == (CMD_PUSHQ | PTR_FLAG | NUM_FLAG | REG_FLAG))
+            {
+                CPU_PUSH(stkCPU_FLT_, *(FLT_TYPE*)(RAM_ + ptr));
+            }
+            break;
+
+        case CMD_POP:
+
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
+            break;
+
+        case CMD_POPQ:
+
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            break;
+
+        case CMD_POP  | REG_FLAG:
+        case CMD_POPQ | REG_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK((reg_code > REG_NUM), CPU_UNIDENTIFIED_REGISTER, this);
+
+            if (cmd_code == (CMD_POP | REG_FLAG))
+            {
+                err = Pop1IntNumber(&num_int1);
+                CPU_ASSERTOK(err, err, this);
+                registers_[reg_code - 1] = num_int1;
+            }
+            else if (cmd_code == (CMD_POPQ | REG_FLAG))
+            {
+                err = Pop1FloatNumber(&num_flt1);
+                CPU_ASSERTOK(err, err, this);
+                registers_[reg_code - 1] = num_flt1;
+            }
+            break;
+
+        case CMD_POP  | PTR_FLAG | NUM_FLAG:
+        case CMD_POPQ | PTR_FLAG | NUM_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+
+            ptr = *(PTR_TYPE*)(bcode_.data_ + bcode_.ptr_);
+            CPU_ASSERTOK((ptr + NumberSize(cmd_code) > RAM_SIZE), CPU_WRONG_ADDR, this);
+            bcode_.ptr_ += POINTER_SIZE;
+
+            MarkDirty(ptr, NumberSize(cmd_code));
+
+            if (cmd_code == (CMD_POP | PTR_FLAG | NUM_FLAG))
+            {
+                err = Pop1IntNumber(&num_int1);
+                CPU_ASSERTOK(err, err, this);
+                *(INT_TYPE*)(RAM_ + ptr) = num_int1;
+            }
+            else if (cmd_code == (CMD_POPQ | PTR_FLAG | NUM_FLAG))
+            {
+                err = Pop1FloatNumber(&num_flt1);
+                CPU_ASSERTOK(err, err, this);
+                *(FLT_TYPE*)(RAM_ + ptr) = num_flt1;
+            }
+            break;
+
+        case CMD_POP  | PTR_FLAG | REG_FLAG:
+        case CMD_POPQ | PTR_FLAG | REG_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+
+            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
+            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
+            CPU_ASSERTOK((ptr + NumberSize(cmd_code) > RAM_SIZE), CPU_WRONG_ADDR, this);
+
+            MarkDirty(ptr, NumberSize(cmd_code));
+
+            if (cmd_code == (CMD_POP | PTR_FLAG | REG_FLAG))
+            {
+                err = Pop1IntNumber(&num_int1);
+                CPU_ASSERTOK(err, err, this);
+                *(INT_TYPE*)(RAM_ + ptr) = num_int1;
+            }
+            else if (cmd_code == (CMD_POPQ | PTR_FLAG | REG_FLAG))
+            {
+                err = Pop1FloatNumber(&num_flt1);
+                CPU_ASSERTOK(err, err, this);
+                *(FLT_TYPE*)(RAM_ + ptr) = num_flt1;
+            }
+            break;
+
+        case CMD_POP  | PTR_FLAG | REG_FLAG | NUM_FLAG:
+        case CMD_POPQ | PTR_FLAG | REG_FLAG | NUM_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1 + NUMBER_INT_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+
+            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
+            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
+            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
+
+            ptr += *(INT_TYPE*)(bcode_.data_ + bcode_.ptr_);
+            CPU_ASSERTOK((ptr + NumberSize(cmd_code) > RAM_SIZE), CPU_WRONG_ADDR, this);
+            bcode_.ptr_ += NUMBER_INT_SIZE;
+
+            MarkDirty(ptr, NumberSize(cmd_code));
+
+            if (cmd_code == (CMD_POP | PTR_FLAG | REG_FLAG | NUM_FLAG))
+            {
+                err = Pop1IntNumber(&num_int1);
+                CPU_ASSERTOK(err, err, this);
+                *(INT_TYPE*)(RAM_ + ptr) = num_int1;
+            }
+            else if (cmd_code == (CMD_POPQ | PTR_FLAG | REG_FLAG | NUM_FLAG))
+            {
+                err = Pop1FloatNumber(&num_flt1);
+                CPU_ASSERTOK(err, err, this);
+                *(FLT_TYPE*)(RAM_ + ptr) = num_flt1;
+            }
+            break;
+
+        case CMD_IN:
+
+            err = Input(&num_int1, 'i');
+            CPU_ASSERTOK(err, err, nullptr);
+            CPU_PUSH(stkCPU_INT_, num_int1);
+            break;
+
+        case CMD_INQ:
+
+            err = Input(&num_flt1, 'f');
+            CPU_ASSERTOK(err, err, nullptr);
+            CPU_PUSH(stkCPU_FLT_, num_flt1);
+            break;
+
+        case CMD_IN  | REG_FLAG:
+        case CMD_INQ | REG_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+
+            if (cmd_code == (CMD_IN | REG_FLAG))
+            {
+                err = Input(&num_int1, 'i');
+                CPU_ASSERTOK(err, err, nullptr);
+                registers_[reg_code - 1] = num_int1;
+            }
+            else if (cmd_code == (CMD_INQ | REG_FLAG))
+            {
+                err = Input(&num_flt1, 'f');
+                CPU_ASSERTOK(err, err, nullptr);
+                registers_[reg_code - 1] = num_flt1;
+            }
+            break;
+
+        case CMD_OUT:
+
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int1);
+            PrintNumber(out_, io_mode_, num_int1);
+            break;
+
+        case CMD_OUTQ:
+
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, num_flt1);
+            PrintNumber(out_, io_mode_, num_flt1);
+            break;
+
+        case CMD_OUT  | REG_FLAG:
+        case CMD_OUTQ | REG_FLAG:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+
+            if (cmd_code == (CMD_OUT | REG_FLAG))
+                PrintNumber(out_, io_mode_, (INT_TYPE)registers_[reg_code - 1]);
+            else
+            if (cmd_code == (CMD_OUTQ | REG_FLAG))
+                PrintNumber(out_, io_mode_, (FLT_TYPE)registers_[reg_code - 1]);
+            break;
+
+        case CMD_ADD:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 + num_int1);
+            break;
+
+        case CMD_ADDQ:
+
+            err = Pop2FloatNumbers(&num_flt1, &num_flt2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, num_flt2 + num_flt1);
+            break;
+
+        case CMD_SUB:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 - num_int1);
+            break;
+
+        case CMD_SUBQ:
+
+            err = Pop2FloatNumbers(&num_flt1, &num_flt2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, num_flt2 - num_flt1);
+            break;
+
+        case CMD_MUL:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 * num_int1);
+            break;
+
+        case CMD_MULQ:
+
+            err = Pop2FloatNumbers(&num_flt1, &num_flt2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, num_flt2 * num_flt1);
+            break;
+
+        case CMD_DIV:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_ASSERTOK((fabs(num_int1) < NIL), CPU_DIVISION_BY_ZERO, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 / num_int1);
+            break;
+
+        case CMD_DIVQ:
+
+            err = Pop2FloatNumbers(&num_flt1, &num_flt2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_ASSERTOK((fabs(num_flt1) < NIL), CPU_DIVISION_BY_ZERO, this);
+            CPU_PUSH(stkCPU_FLT_, num_flt2 / num_flt1);
+            break;
+
+        case CMD_NEG:
+
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, -num_int1);
+            break;
+
+        case CMD_NEGQ:
+
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, -num_flt1);
+            break;
+
+        case CMD_AND:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 & num_int1);
+            break;
+
+        case CMD_OR:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 | num_int1);
+            break;
+
+        case CMD_XOR:
+
+            err = Pop2IntNumbers(&num_int1, &num_int2);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, num_int2 ^ num_int1);
+            break;
+
+        case CMD_SIN:
+
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, sin(num_flt1));
+            break;
+
+        case CMD_COS:
+
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, cos(num_flt1));
+            break;
+
+        case CMD_SQRT:
+
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_ASSERTOK((num_flt1 < 0), CPU_ROOT_OF_A_NEG_NUMBER, this);
+            CPU_PUSH(stkCPU_FLT_, sqrt(num_flt1));
+            break;
+
+        case CMD_JMP:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+
+            bcode_.ptr_ = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
+            break;
+
+        case CMD_JE:
+        case CMD_JNE:
+        case CMD_JA:
+        case CMD_JAE:
+        case CMD_JB:
+        case CMD_JBE:
+
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+            err = Pop2FloatNumbers(&num_flt1, &num_flt2);
+            CPU_ASSERTOK(err, err, this);
+            
+            if (cmd_code == CMD_JE ) cond = (fabs(num_flt1 - num_flt2) <  NIL); else
+            if (cmd_code == CMD_JNE) cond = (fabs(num_flt1 - num_flt2) >= NIL); else
+            if (cmd_code == CMD_JA ) cond = (num_flt1 >  num_flt2);             else
+            if (cmd_code == CMD_JAE) cond = (num_flt1 >= num_flt2);             else
+            if (cmd_code == CMD_JB ) cond = (num_flt1 <  num_flt2);             else
+            if (cmd_code == CMD_JBE) cond = (num_flt1 <= num_flt2);/////////////////
+            if (cond)
+                bcode_.ptr_ = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
+            else
+                bcode_.ptr_ += POINTER_SIZE;
+            break;
+
+        case CMD_CALL:
 
-//------------------------------------------------------------------------------
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
 
-CPU::~CPU ()
-{
-    CPU_ASSERTOK((this == nullptr),          CPU_NULL_INPUT_CPU_PTR, nullptr);
-    CPU_ASSERTOK((state_ == CPU_DESTRUCTED), CPU_DESTRUCTED,         nullptr);
+            CPU_PUSH(stkCPU_PTR_, (PTR_TYPE)(bcode_.ptr_ + POINTER_SIZE));
+            bcode_.ptr_ = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
+            break;
 
-    for (int i = 0; i < REG_NUM; ++i)
-    {
-        registers_[i] = POISON<FLT_TYPE>;
-    }
+        case CMD_LCALL:
+        {
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE + 1), CPU_NO_SPACE_FOR_MODULE, this);
 
-    delete [] RAM_;
+            size_t len = (unsigned char)bcode_.data_[bcode_.ptr_ + POINTER_SIZE];
+            CPU_ASSERTOK(((len == 0) || (bcode_.size_ - bcode_.ptr_ < POINTER_SIZE + 1 + len)), CPU_NO_SPACE_FOR_MODULE, this);
 
-    state_ = CPU_DESTRUCTED;
-}
+            ptr_t target = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
+            if (target == 0)
+            {
+                err = LinkModule(bcode_.ptr_, &target);
+                CPU_ASSERTOK(err, err, this);
+            }
 
-//------------------------------------------------------------------------------
+            CPU_PUSH(stkCPU_PTR_, (PTR_TYPE)(bcode_.ptr_ + POINTER_SIZE + 1 + len));
+            bcode_.ptr_ = target;
+            break;
+        }
 
-int CPU::Execute ()
-{
-    CPU_ASSERTOK((this == nullptr), CPU_NULL_INPUT_CPU_PTR, nullptr);
+        case CMD_RET:
 
-    bcode_.ptr_ = 0;
+            ptr = stkCPU_PTR_.Pop();
+            CPU_ASSERTOK((isPOISON(ptr)), CPU_NO_RET_ADDRESS, this);
 
-    char reg_code = 0;
+            bcode_.ptr_ = ptr;
+            break;
 
-    int width  = 0;
-    int height = 0;
+        case CMD_FLT2INT:
 
-    PTR_TYPE ptr = POISON<PTR_TYPE>;
+            err = Pop1FloatNumber(&num_flt1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_INT_, (INT_TYPE)num_flt1);
+            break;
 
-    INT_TYPE num_int1 = POISON<INT_TYPE>;
-    INT_TYPE num_int2 = POISON<INT_TYPE>;
+        case CMD_INT2FLT:
 
-    FLT_TYPE num_flt1 = POISON<FLT_TYPE>;
-    FLT_TYPE num_flt2 = POISON<FLT_TYPE>;
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
+            CPU_PUSH(stkCPU_FLT_, (FLT_TYPE)num_int1);
+            break;
 
-    sf::RenderWindow* window  = nullptr;
+        case CMD_SCREEN:
+        {
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
 
-    while (bcode_.ptr_ < bcode_.size_)
-    {
-        char cond = 0;
+            reg_code = bcode_.data_[bcode_.ptr_++];
+            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+            CPU_ASSERTOK((isPOISON(registers_[reg_code - 1])), CPU_EMPTY_REGISTER, this);
 
-        unsigned char cmd_code = bcode_.data_[bcode_.ptr_++];
+            ptr = (PTR_TYPE)(int)registers_[reg_code - 1];
+            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
+            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
 
-        switch (cmd_code)
-        {
-        case CMD_HLT:
-            
-            return PROCESS_HALT;
-            break;
+            CPU_ASSERTOK((isPOISON(registers_[REG_SCRX - 1])), CPU_EMPTY_REGISTER, this);
+            CPU_ASSERTOK((isPOISON(registers_[REG_SCRY - 1])), CPU_EMPTY_REGISTER, this);
 
-        case CMD_PUSH | NUM_FLAG:
+            width  = (int)(registers_[REG_SCRX - 1]);
+            height = (int)(registers_[REG_SCRY - 1]);
+            CPU_ASSERTOK(((width <= 0) || (height <= 0)), CPU_INCORRECT_WINDOW_SIZES, this);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < NUMBER_INT_SIZE), CPU_NO_SPACE_FOR_NUMBER_INT, this);
+            // empty scrm is the RGB888 mode of old programs
+            int mode = (isPOISON(registers_[REG_SCRM - 1])) ? VIDEO_RGB888 : (int)(registers_[REG_SCRM - 1]);
+            CPU_ASSERTOK(((mode < 0) || (mode >= VIDEO_MODES_NUM)), CPU_WRONG_VIDEO_MODE, this);
+            CPU_ASSERTOK((ptr + VideoMemSize(width, height, mode) > RAM_SIZE), CPU_NO_VIDEO_MEMORY, this);
 
-            num_int1 = *(INT_TYPE*)(bcode_.data_ + bcode_.ptr_);
-            stkCPU_INT_.Push(num_int1);
-            bcode_.ptr_ += NUMBER_INT_SIZE;
-            break;
+            CPU* root = this;
+            while (root->parent_ != nullptr) root = root->parent_;
 
-        case CMD_PUSHQ | NUM_FLAG:
+            // video_ of the root is shared by the guest threads, it is written under the screen lock
+            std::lock_guard<std::mutex> lock(root->screen_lock_);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < NUMBER_FLT_SIZE), CPU_NO_SPACE_FOR_NUMBER_FLT, this);
+            size_t video = root->getScreenSize(width, height, mode);
+            CPU_ASSERTOK(((mem_limit_ != 0) && (getHeapSize() + video > mem_limit_)), CPU_MEMORY_LIMIT, this);
+            root->video_ = video;
 
-            num_flt1 = *(FLT_TYPE*)(bcode_.data_ + bcode_.ptr_);
-            stkCPU_FLT_.Push(num_flt1);
-            bcode_.ptr_ += NUMBER_FLT_SIZE;
+            err = root->DysplayVideoMem(width, height, ptr, mode);
+            CPU_ASSERTOK(err, err, this);
             break;
+        }
+        case CMD_SPAWN:
 
-        case CMD_PUSH  | REG_FLAG:
-        case CMD_PUSHQ | REG_FLAG:
-
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
-            CPU_ASSERTOK(isPOISON(registers_[reg_code - 1]), CPU_EMPTY_REGISTER, this);
+            err = Spawn(*(ptr_t*)(bcode_.data_ + bcode_.ptr_), &num_int1);
+            CPU_ASSERTOK(err, err, this);
 
-            if (cmd_code == (CMD_PUSH | REG_FLAG))
-                stkCPU_INT_.Push((INT_TYPE)registers_[reg_code - 1]);
-            else
-            if (cmd_code == (CMD_PUSHQ | REG_FLAG))
-                stkCPU_FLT_.Push((FLT_TYPE)registers_[reg_code - 1]);
+            CPU_PUSH(stkCPU_INT_, num_int1);
+            bcode_.ptr_ += POINTER_SIZE;
             break;
 
-        case CMD_PUSH  | PTR_FLAG | NUM_FLAG:
-        case CMD_PUSHQ | PTR_FLAG | NUM_FLAG:
-
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+        case CMD_JOIN:
 
-            ptr = *(PTR_TYPE*)(bcode_.data_ + bcode_.ptr_);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
-            bcode_.ptr_ += POINTER_SIZE;
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
 
-            if (cmd_code == (CMD_PUSH | PTR_FLAG | NUM_FLAG))
-                stkCPU_INT_.Push(*(INT_TYPE*)(RAM_ + ptr));
-            else
-            if (cmd_code == (CMD_PUSHQ | PTR_FLAG | NUM_FLAG))
-                stkCPU_FLT_.Push(*(FLT_TYPE*)(RAM_ + ptr));
+            err = Join(num_int1);
+            CPU_ASSERTOK(err, err, this);
             break;
 
-        case CMD_PUSH  | PTR_FLAG | REG_FLAG:
-        case CMD_PUSHQ | PTR_FLAG | REG_FLAG:
-
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+        case CMD_CAS:
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
-            CPU_ASSERTOK(isPOISON(registers_[reg_code - 1]), CPU_EMPTY_REGISTER, this);
+            err = Pop2IntNumbers(&num_int1, &num_int2); // desired, expected
+            CPU_ASSERTOK(err, err, this);
 
-            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
-            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
+            err = PopAtomicAddr(&ptr);
+            CPU_ASSERTOK(err, err, this);
+            MarkDirty(ptr, NUMBER_INT_SIZE);
 
-            if (cmd_code == (CMD_PUSH | PTR_FLAG | REG_FLAG))
-                stkCPU_INT_.Push(*(INT_TYPE*)(RAM_ + ptr));
-            else
-            if (cmd_code == (CMD_PUSHQ | PTR_FLAG | REG_FLAG))
-                stkCPU_FLT_.Push(*(FLT_TYPE*)(RAM_ + ptr));
+            // on failure the expected value is replaced with the current one, so num_int2 is always the old value
+            __atomic_compare_exchange_n((INT_TYPE*)(RAM_ + ptr), &num_int2, num_int1, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+            CPU_PUSH(stkCPU_INT_, num_int2);
             break;
 
-        case CMD_PUSH  | PTR_FLAG | REG_FLAG | NUM_FLAG:
-        case CMD_PUSHQ | PTR_FLAG | REG_FLAG | NUM_FLAG:
+        case CMD_XADD:
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1 + NUMBER_INT_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
-            CPU_ASSERTOK(isPOISON(registers_[reg_code - 1]), CPU_EMPTY_REGISTER, this);
+            err = PopAtomicAddr(&ptr);
+            CPU_ASSERTOK(err, err, this);
+            MarkDirty(ptr, NUMBER_INT_SIZE);
+            CPU_PUSH(stkCPU_INT_, __atomic_fetch_add((INT_TYPE*)(RAM_ + ptr), num_int1, __ATOMIC_SEQ_CST));
+            break;
 
-            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
-            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
-            
-            ptr += *(INT_TYPE*)(bcode_.data_ + bcode_.ptr_);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
-            bcode_.ptr_ += NUMBER_INT_SIZE;
+        case CMD_XCHG:
 
-            if (cmd_code == (CMD_PUSH | PTR_FLAG | NUM_FLAG | REG_FLAG))
-                stkCPU_INT_.Push(*(INT_TYPE*)(RAM_ + ptr));
-            else
-            if (cmd_code == (CMD_PUSHQ | PTR_FLAG | NUM_FLAG | REG_FLAG))
-                stkCPU_FLT_.Push(*(FLT_TYPE*)(RAM_ + ptr));
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
+
+            err = PopAtomicAddr(&ptr);
+            CPU_ASSERTOK(err, err, this);
+            MarkDirty(ptr, NUMBER_INT_SIZE);
+            CPU_PUSH(stkCPU_INT_, __atomic_exchange_n((INT_TYPE*)(RAM_ + ptr), num_int1, __ATOMIC_SEQ_CST));
             break;
 
-        case CMD_POP:
+        case CMD_FENCE:
 
-            Pop1IntNumber(&num_int1);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
             break;
 
-        case CMD_POPQ:
+        case CMD_AREAD:
+        case CMD_AWRITE:
+        {
+            err = Pop2IntNumbers(&num_int1, &num_int2); // length, address
+            CPU_ASSERTOK(err, err, this);
+            CPU_ASSERTOK(((num_int1 < 0) || (num_int2 < 0) || ((size_t)num_int2 + num_int1 > RAM_SIZE)), CPU_WRONG_ADDR, this);
 
-            Pop1FloatNumber(&num_flt1);
-            break;
+            CPU* root = this;
+            while (root->parent_ != nullptr) root = root->parent_;
 
-        case CMD_POP  | REG_FLAG:
-        case CMD_POPQ | REG_FLAG:
+            if (cmd_code == CMD_AREAD) MarkDirty(num_int2, num_int1);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+            int id = (cmd_code == CMD_AREAD) ? root->aio_.Submit(AIO_READ,  in_,  RAM_ + num_int2, num_int1)
+                                             : root->aio_.Submit(AIO_WRITE, out_, RAM_ + num_int2, num_int1);
+            CPU_ASSERTOK((id < 0), CPU_TOO_MANY_REQUESTS, this);
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK((reg_code > REG_NUM), CPU_UNIDENTIFIED_REGISTER, this);
+            CPU_PUSH(stkCPU_INT_, id);
+            break;
+        }
+        case CMD_APOLL:
+        case CMD_AWAIT:
+        {
+            err = Pop1IntNumber(&num_int1);
+            CPU_ASSERTOK(err, err, this);
 
-            if (cmd_code == (CMD_POP | REG_FLAG))
+            CPU* root = this;
+            while (root->parent_ != nullptr) root = root->parent_;
+
+            int done = root->aio_.Poll(num_int1);
+            CPU_ASSERTOK((done < 0), CPU_WRONG_REQUEST_ID, this);
+
+            if (cmd_code == CMD_APOLL)
             {
-                Pop1IntNumber(&num_int1);
-                registers_[reg_code - 1] = num_int1;
+                CPU_PUSH(stkCPU_INT_, num_int1);
+                CPU_PUSH(stkCPU_INT_, done);
+                break;
             }
-            else if (cmd_code == (CMD_POPQ | REG_FLAG))
+
+            // a cpu with a step budget is parked instead of blocking its host thread
+            if (!done && (steps != 0))
             {
-                Pop1FloatNumber(&num_flt1);
-                registers_[reg_code - 1] = num_flt1;
+                CPU_PUSH(stkCPU_INT_, num_int1);
+                --bcode_.ptr_;
+                --steps_;
+                waiting_ = true;
+                return PROCESS_PAUSED;
             }
+
+            long result = 0;
+            root->aio_.Wait(num_int1, &result);
+
+            CPU_PUSH(stkCPU_INT_, (INT_TYPE)result);
             break;
+        }
+        case CMD_FLOAD:
+        case CMD_FSTORE:
+        {
+            err = Pop2IntNumbers(&num_int1, &num_int2); // length, offset in the file
+            CPU_ASSERTOK(err, err, this);
 
-        case CMD_POP  | PTR_FLAG | NUM_FLAG:
-        case CMD_POPQ | PTR_FLAG | NUM_FLAG:
+            INT_TYPE addr = 0;
+            INT_TYPE name = 0;
+            err = Pop2IntNumbers(&addr, &name);
+            CPU_ASSERTOK(err, err, this);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+            CPU_ASSERTOK(((num_int1 < 0) || (num_int2 < 0) || (addr < 0) || ((size_t)addr + num_int1 > RAM_SIZE)), CPU_WRONG_ADDR, this);
 
-            ptr = *(PTR_TYPE*)(bcode_.data_ + bcode_.ptr_);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
-            bcode_.ptr_ += POINTER_SIZE;
+            int fd = -1;
+            err = OpenGuestFile(name, (cmd_code == CMD_FLOAD) ? O_RDONLY : (O_WRONLY | O_CREAT), &fd);
+            CPU_ASSERTOK(err, err, this);
 
-            if (cmd_code == (CMD_POP | PTR_FLAG | NUM_FLAG))
-            {
-                Pop1IntNumber(&num_int1);
-                *(INT_TYPE*)(RAM_ + ptr) = num_int1;
-            }
-            else if (cmd_code == (CMD_POPQ | PTR_FLAG | NUM_FLAG))
+            // one system call moves the whole range, there is no parsing of numbers
+            ssize_t done = 0;
+            ssize_t len  = 0;
+            while (done < num_int1)
             {
-                Pop1FloatNumber(&num_flt1);
-                *(FLT_TYPE*)(RAM_ + ptr) = num_flt1;
+                len = (cmd_code == CMD_FLOAD) ? pread (fd, RAM_ + addr + done, num_int1 - done, num_int2 + done)
+                                              : pwrite(fd, RAM_ + addr + done, num_int1 - done, num_int2 + done);
+                if (len <= 0) break;
+
+                done += len;
             }
-            break;
+            close(fd);
 
-        case CMD_POP  | PTR_FLAG | REG_FLAG:
-        case CMD_POPQ | PTR_FLAG | REG_FLAG:
+            CPU_ASSERTOK((len < 0), CPU_GUEST_FILE_ERROR, this);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+            if (cmd_code == CMD_FLOAD) MarkDirty(addr, done);
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+            // the result depends on the file now, and a stored file is not made again by a memo hit
+            for (CPU* cpu = this; cpu != nullptr; cpu = cpu->parent_) cpu->deterministic_ = false;
 
-            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
-            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
+            CPU_PUSH(stkCPU_INT_, (INT_TYPE)done);
+            break;
+        }
+        case CMD_READY:
 
-            if (cmd_code == (CMD_POP | PTR_FLAG | REG_FLAG))
-            {
-                Pop1IntNumber(&num_int1);
-                *(INT_TYPE*)(RAM_ + ptr) = num_int1;
-            }
-            else if (cmd_code == (CMD_POPQ | PTR_FLAG | REG_FLAG))
+            err = Pop2IntNumbers(&num_int1, &num_int2); // length, address
+            CPU_ASSERTOK(err, err, this);
+            CPU_ASSERTOK(((num_int1 < 0) || (num_int2 < 0) || ((size_t)num_int2 + num_int1 > RAM_SIZE)), CPU_WRONG_ADDR, this);
+
+            for (size_t page = num_int2 / CHECK_PAGE_SIZE; (share_ != nullptr) && (num_int1 > 0) && (page <= (num_int2 + num_int1 - 1) / CHECK_PAGE_SIZE); ++page)
             {
-                Pop1FloatNumber(&num_flt1);
-                *(FLT_TYPE*)(RAM_ + ptr) = num_flt1;
+                __atomic_store_n(share_->ready + page, 1, __ATOMIC_RELEASE);
             }
             break;
 
-        case CMD_POP  | PTR_FLAG | REG_FLAG | NUM_FLAG:
-        case CMD_POPQ | PTR_FLAG | REG_FLAG | NUM_FLAG:
+        case CMD_HCALL:
+        {
+            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_HOST_CALL, this);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1 + NUMBER_INT_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+            const HostFunction& host = host_funcs_[(unsigned char)bcode_.data_[bcode_.ptr_++]];
+            CPU_ASSERTOK((host.func == nullptr), CPU_UNREGISTERED_HOST_CALL, this);
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+            // an error of the cpu is kept as is, any other code is only known to be a failure
+            int err = host.func(this, host.data);
+            CPU_ASSERTOK(((err < CPU_OK) || (err > CPU_WRONG_VIDEO_MODE)), CPU_HOST_CALL_FAILED, this);
+            CPU_ASSERTOK((err != CPU_OK),                                  err,                  this);
+            break;
+        }
 
-            ptr = (PTR_TYPE)(long long int)registers_[reg_code - 1];
-            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
+        default:
 
-            ptr += *(INT_TYPE*)(bcode_.data_ + bcode_.ptr_);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
-            bcode_.ptr_ += NUMBER_INT_SIZE;
+            CPU_ASSERTOK(1, CPU_UNIDENTIFIED_COMMAND, this);
 
-            if (cmd_code == (CMD_POP | PTR_FLAG | REG_FLAG | NUM_FLAG))
-            {
-                Pop1IntNumber(&num_int1);
-                *(INT_TYPE*)(RAM_ + ptr) = num_int1;
-            }
-            else if (cmd_code == (CMD_POPQ | PTR_FLAG | REG_FLAG | NUM_FLAG))
-            {
-                Pop1FloatNumber(&num_flt1);
-                *(FLT_TYPE*)(RAM_ + ptr) = num_flt1;
-            }
-            break;
+            return CPU_NOT_OK;
+        }
+    }
+
+    return PROCESS_PAUSED;
+}
+
+//------------------------------------------------------------------------------
+
+const CPUFault& CPU::getFault () const
+{
+    return fault_;
+}
+
+//------------------------------------------------------------------------------
+
+size_t CPU::getSteps () const
+{
+    return steps_;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::setLogging (bool log)
+{
+    log_ = log;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::getScreensNum () const
+{
+    return screens_num_;
+}
+
+//------------------------------------------------------------------------------
+
+bool CPU::isDeterministic () const
+{
+    return deterministic_;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::setIO (FILE* in, FILE* out)
+{
+    in_  = (in  == nullptr) ? stdin  : in;
+    out_ = (out == nullptr) ? stdout : out;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::setIOMode (int mode)
+{
+    io_mode_ = mode;
+}
+
+//------------------------------------------------------------------------------
+
+int CPU::Record (const char* filename)
+{
+    CPU_ASSERTOK((this == nullptr),     CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((filename == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
+
+    if (record_ != nullptr) fclose(record_);
+
+    record_ = fopen(filename, "wb");
+    CPU_ASSERTOK((record_ == nullptr), CPU_RECORD_FILE_ERROR, nullptr);
+
+    RecordHeader header = {};
+    memcpy(header.signature, RECORD_SIGNATURE, sizeof(header.signature));
+    header.version = RECORD_VERSION;
+    header.variant = NUM_VARIANT;
+
+    CPU_ASSERTOK((fwrite(&header, sizeof(RecordHeader), 1, record_) != 1), CPU_RECORD_FILE_ERROR, nullptr);
+
+    return CPU_OK;
+}
 
-        case CMD_IN:
+//------------------------------------------------------------------------------
 
-            printf("IN: ");
-            CPU_ASSERTOK((scanf(PRINT_FORMAT<INT_TYPE>, &num_int1) != 1), CPU_INCORRECT_INPUT, nullptr);
-            stkCPU_INT_.Push(num_int1);
-            break;
+int CPU::Replay (const char* filename)
+{
+    CPU_ASSERTOK((this == nullptr),     CPU_NULL_INPUT_CPU_PTR,  nullptr);
+    CPU_ASSERTOK((filename == nullptr), CPU_NULL_INPUT_FILENAME, nullptr);
 
-        case CMD_INQ:
+    if (replay_ != nullptr) fclose(replay_);
 
-            printf("IN: ");
-            CPU_ASSERTOK((scanf(PRINT_FORMAT<FLT_TYPE>, &num_flt1) != 1), CPU_INCORRECT_INPUT, nullptr);
-            stkCPU_FLT_.Push(num_flt1);
-            break;
+    replay_ = fopen(filename, "rb");
+    CPU_ASSERTOK((replay_ == nullptr), CPU_RECORD_FILE_ERROR, nullptr);
 
-        case CMD_IN  | REG_FLAG:
-        case CMD_INQ | REG_FLAG:
+    RecordHeader header = {};
+    bool wrong = (fread(&header, sizeof(RecordHeader), 1, replay_) != 1)                      ||
+                 (memcmp(header.signature, RECORD_SIGNATURE, sizeof(header.signature)) != 0) ||
+                 (header.version != RECORD_VERSION) || (header.variant != NUM_VARIANT);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+    CPU_ASSERTOK(wrong, CPU_RECORD_FILE_ERROR, nullptr);
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+    return CPU_OK;
+}
 
-            printf("IN: ");
+//------------------------------------------------------------------------------
 
-            if (cmd_code == (CMD_IN | REG_FLAG))
-            {
-                CPU_ASSERTOK((scanf(PRINT_FORMAT<INT_TYPE>, &num_int1) != 1), CPU_INCORRECT_INPUT, nullptr);
-                registers_[reg_code - 1] = num_int1;
-            }
-            else if (cmd_code == (CMD_INQ | REG_FLAG))
-            {
-                CPU_ASSERTOK((scanf(PRINT_FORMAT<FLT_TYPE>, &num_flt1) != 1), CPU_INCORRECT_INPUT, nullptr);
-                registers_[reg_code - 1] = num_flt1;
-            }
-            break;
+void CPU::setSandbox (const char* dir)
+{
+    if (dir == nullptr) sandbox_[0] = '\0';
+    else                strncpy(sandbox_, dir, MAX_NAME_LEN - 1);
+}
 
-        case CMD_OUT:
+//------------------------------------------------------------------------------
 
-            Pop1IntNumber(&num_int1);
-            stkCPU_INT_.Push(num_int1);
-            printf("OUT: ");
-            printf(PRINT_FORMAT<INT_TYPE>, num_int1);
-            printf("\n");
-            break;
+void CPU::Register (unsigned char code, HostFunc func, void* data)
+{
+    host_funcs_[code].func = func;
+    host_funcs_[code].data = data;
+}
 
-        case CMD_OUTQ:
+//------------------------------------------------------------------------------
 
-            Pop1FloatNumber(&num_flt1);
-            stkCPU_FLT_.Push(num_flt1);
-            printf("OUT: ");
-            printf(PRINT_FORMAT<FLT_TYPE>, num_flt1);
-            printf("\n");
-            break;
+CPUMemory CPU::getMemory () const
+{
+    CPUMemory memory = {};
 
-        case CMD_OUT  | REG_FLAG:
-        case CMD_OUTQ | REG_FLAG:
+    memory.stacks_reserved = stkCPU_INT_.getCapacity() * sizeof(INT_TYPE) +
+                             stkCPU_FLT_.getCapacity() * sizeof(FLT_TYPE) +
+                             stkCPU_PTR_.getCapacity() * sizeof(PTR_TYPE);
+    memory.stacks_touched  = stkCPU_INT_.getSize()     * sizeof(INT_TYPE) +
+                             stkCPU_FLT_.getSize()     * sizeof(FLT_TYPE) +
+                             stkCPU_PTR_.getSize()     * sizeof(PTR_TYPE);
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+    memory.code        = bcode_.size_;
+    memory.code_shared = (image_ != nullptr) || (parent_ != nullptr);
+    memory.video       = video_;
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
+    if ((parent_ != nullptr) || (RAM_ == nullptr)) return memory;
 
-            printf("OUT: ");
-            if (cmd_code == (CMD_OUT | REG_FLAG))
-                printf(PRINT_FORMAT<INT_TYPE>, (int)registers_[reg_code - 1]);
-            else
-            if (cmd_code == (CMD_OUTQ | REG_FLAG))
-                printf(PRINT_FORMAT<FLT_TYPE>, registers_[reg_code - 1]);
-            printf("\n");
-            break;
+    memory.ram_reserved = RAM_SIZE;
 
-        case CMD_ADD:
+    // pages of RAM the host has really given to the cpu
+    size_t page  = sysconf(_SC_PAGESIZE);
+    char*  start = RAM_ - (size_t)RAM_ % page;
+    size_t pages = (RAM_ + RAM_SIZE - start + page - 1) / page;
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            stkCPU_INT_.Push(num_int2 + num_int1);
-            break;
+    unsigned char* core = new (std::nothrow) unsigned char[pages];
+    if ((core != nullptr) && (mincore(start, pages * page, core) == 0))
+    {
+        size_t touched = 0;
+        for (size_t i = 0; i < pages; ++i) touched += core[i] & 1;
 
-        case CMD_ADDQ:
+        memory.ram_touched = std::min(touched * page, RAM_SIZE);
+    }
+    delete [] core;
 
-            Pop2FloatNumbers(&num_flt1, &num_flt2);
-            stkCPU_FLT_.Push(num_flt2 + num_flt1);
-            break;
+    return memory;
+}
 
-        case CMD_SUB:
+//------------------------------------------------------------------------------
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            stkCPU_INT_.Push(num_int2 - num_int1);
-            break;
+void CPU::setMemoryLimit (size_t limit)
+{
+    mem_limit_ = limit;
+}
 
-        case CMD_SUBQ:
+//------------------------------------------------------------------------------
 
-            Pop2FloatNumbers(&num_flt1, &num_flt2);
-            stkCPU_FLT_.Push(num_flt2 - num_flt1);
-            break;
+void CPU::PrintMemory (FILE* fp)
+{
+    assert(fp != nullptr);
 
-        case CMD_MUL:
+    std::lock_guard<std::mutex> guard(cpus_lock_);
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            stkCPU_INT_.Push(num_int2 * num_int1);
-            break;
+    CPUMemory total = {};
+    std::unordered_set<const char*> codes;
 
-        case CMD_MULQ:
+    for (CPU* cpu : cpus_)
+    {
+        CPUMemory memory = cpu->getMemory();
 
-            Pop2FloatNumbers(&num_flt1, &num_flt2);
-            stkCPU_FLT_.Push(num_flt2 * num_flt1);
-            break;
+        total.ram_reserved    += memory.ram_reserved;
+        total.ram_touched     += memory.ram_touched;
+        total.stacks_reserved += memory.stacks_reserved;
+        total.stacks_touched  += memory.stacks_touched;
+        total.video           += memory.video;
 
-        case CMD_DIV:
+        if (codes.insert(cpu->bcode_.data_).second) total.code += memory.code;
+    }
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            CPU_ASSERTOK((fabs(num_int1) < NIL), CPU_DIVISION_BY_ZERO, this);
-            stkCPU_INT_.Push(num_int2 / num_int1);
-            break;
+    fprintf(fp, ";;;; memory of %zu cpus: RAM %zu reserved, %zu touched; stacks %zu reserved, %zu touched; code %zu; screens %zu ;;;;\n",
+            cpus_.size(), total.ram_reserved, total.ram_touched, total.stacks_reserved, total.stacks_touched, total.code, total.video);
+}
 
-        case CMD_DIVQ:
+//------------------------------------------------------------------------------
 
-            Pop2FloatNumbers(&num_flt1, &num_flt2);
-            CPU_ASSERTOK((fabs(num_flt1) < NIL), CPU_DIVISION_BY_ZERO, this);
-            stkCPU_FLT_.Push(num_flt2 / num_flt1);
-            break;
+size_t CPU::getHeapSize () const
+{
+    size_t size = stkCPU_INT_.getCapacity() * sizeof(INT_TYPE) +
+                  stkCPU_FLT_.getCapacity() * sizeof(FLT_TYPE) +
+                  stkCPU_PTR_.getCapacity() * sizeof(PTR_TYPE);
 
-        case CMD_NEG:
+    if ((image_ == nullptr) && (parent_ == nullptr)) size += bcode_.size_;
 
-            Pop1IntNumber(&num_int1);
-            stkCPU_INT_.Push(-num_int1);
-            break;
+    return size;
+}
 
-        case CMD_NEGQ:
+//------------------------------------------------------------------------------
 
-            Pop1FloatNumber(&num_flt1);
-            stkCPU_FLT_.Push(-num_flt1);
-            break;
+void CPU::Track (bool alive)
+{
+    std::lock_guard<std::mutex> guard(cpus_lock_);
 
-        case CMD_AND:
+    if (alive) cpus_.insert(this);
+    else       cpus_.erase(this);
+}
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            stkCPU_INT_.Push(num_int2 & num_int1);
-            break;
+//------------------------------------------------------------------------------
 
-        case CMD_OR:
+void CPU::setHeadless (bool headless)
+{
+    headless_ = headless || SCREEN_HEADLESS;
+}
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            stkCPU_INT_.Push(num_int2 | num_int1);
-            break;
+//------------------------------------------------------------------------------
 
-        case CMD_XOR:
+void CPU::setScreenHandler (ScreenFunc func, void* data)
+{
+    screen_func_ = func;
+    screen_data_ = data;
+}
 
-            Pop2IntNumbers(&num_int1, &num_int2);
-            stkCPU_INT_.Push(num_int2 ^ num_int1);
-            break;
+//------------------------------------------------------------------------------
 
-        case CMD_SIN:
+void CPU::setScreenName (const char* name)
+{
+    assert(name != nullptr);
 
-            Pop1FloatNumber(&num_flt1);
-            stkCPU_FLT_.Push(sin(num_flt1));
-            break;
+    strncpy(scrname_, name, MAX_NAME_LEN - 1);
+    scrname_[MAX_NAME_LEN - 1] = '\0';
+}
 
-        case CMD_COS:
+//------------------------------------------------------------------------------
 
-            Pop1FloatNumber(&num_flt1);
-            stkCPU_FLT_.Push(cos(num_flt1));
-            break;
+void CPU::setScreenFormat (int format, size_t encoders)
+{
+    screen_format_ = (format == SCREEN_QOI) ? SCREEN_QOI : SCREEN_PNG;
+    encoder_.setThreads(encoders);
+}
 
-        case CMD_SQRT:
+//------------------------------------------------------------------------------
 
-            Pop1FloatNumber(&num_flt1);
-            CPU_ASSERTOK((num_flt1 < 0), CPU_ROOT_OF_A_NEG_NUMBER, this);
-            stkCPU_FLT_.Push(sqrt(num_flt1));
-            break;
+int CPU::PushIntNumber (INT_TYPE num)
+{
+    // the same limit as the push of a command, the hcall faults with the returned error
+    if (! CanPush(stkCPU_INT_)) return CPU_MEMORY_LIMIT;
 
-        case CMD_JMP:
+    return (stkCPU_INT_.Push(num) == STACK_OK) ? CPU_OK : CPU_NO_MEMORY;
+}
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+//------------------------------------------------------------------------------
 
-            bcode_.ptr_ = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
-            break;
+int CPU::PushFloatNumber (FLT_TYPE num)
+{
+    if (! CanPush(stkCPU_FLT_)) return CPU_MEMORY_LIMIT;
 
-        case CMD_JE:
-        case CMD_JNE:
-        case CMD_JA:
-        case CMD_JAE:
-        case CMD_JB:
-        case CMD_JBE:
+    return (stkCPU_FLT_.Push(num) == STACK_OK) ? CPU_OK : CPU_NO_MEMORY;
+}
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
-            Pop2FloatNumbers(&num_flt1, &num_flt2);
-            
-            if (cmd_code == CMD_JE ) cond = (fabs(num_flt1 - num_flt2) <  NIL); else
-            if (cmd_code == CMD_JNE) cond = (fabs(num_flt1 - num_flt2) >= NIL); else
-            if (cmd_code == CMD_JA ) cond = (num_flt1 >  num_flt2);             else
-            if (cmd_code == CMD_JAE) cond = (num_flt1 >= num_flt2);             else
-            if (cmd_code == CMD_JB ) cond = (num_flt1 <  num_flt2);             else
-            if (cmd_code == CMD_JBE) cond = (num_flt1 <= num_flt2);/////////////////
-            if (cond)
-                bcode_.ptr_ = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
-            else
-                bcode_.ptr_ += POINTER_SIZE;
-            break;
+//------------------------------------------------------------------------------
 
-        case CMD_CALL:
+char* CPU::getRAM ()
+{
+    return RAM_;
+}
 
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE), CPU_NO_SPACE_FOR_POINTER, this);
+//------------------------------------------------------------------------------
 
-            stkCPU_PTR_.Push((PTR_TYPE)(bcode_.ptr_ + POINTER_SIZE));
-            bcode_.ptr_ = *(ptr_t*)(bcode_.data_ + bcode_.ptr_);
-            break;
+int CPU::Spawn (ptr_t entry, INT_TYPE* id)
+{
+    assert(id != nullptr);
 
-        case CMD_RET:
+    int i = 0;
+    while ((i < MAX_THREADS) && (threads_[i].cpu != nullptr)) ++i;
+    if (i == MAX_THREADS) return CPU_TOO_MANY_THREADS;
 
-            ptr = stkCPU_PTR_.Pop();
-            CPU_ASSERTOK((isPOISON(ptr)), CPU_NO_RET_ADDRESS, this);
+    CPU* thread = new CPU(this, entry);
 
-            bcode_.ptr_ = ptr;
-            break;
+    // the order of guest threads is up to the host
+    for (CPU* cpu = this; cpu != nullptr; cpu = cpu->parent_)
+    {
+        cpu->deterministic_ = false;
+    }
 
-        case CMD_FLT2INT:
+    threads_[i].cpu  = thread;
+    threads_[i].host = std::thread([thread]{ thread->result_ = thread->Run(); });
 
-            Pop1FloatNumber(&num_flt1);
-            stkCPU_INT_.Push((INT_TYPE)num_flt1);
-            break;
+    *id = i;
 
-        case CMD_INT2FLT:
+    return CPU_OK;
+}
 
-            Pop1IntNumber(&num_int1);
-            stkCPU_FLT_.Push((FLT_TYPE)num_int1);
-            break;
+//------------------------------------------------------------------------------
 
-        case CMD_SCREEN:
-        {
-            CPU_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), CPU_NO_SPACE_FOR_REGISTER, this);
+int CPU::Join (INT_TYPE id)
+{
+    if ((id < 0) || (id >= MAX_THREADS) || (threads_[id].cpu == nullptr)) return CPU_WRONG_THREAD_ID;
 
-            reg_code = bcode_.data_[bcode_.ptr_++];
-            CPU_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), CPU_UNIDENTIFIED_REGISTER, this);
-            CPU_ASSERTOK((isPOISON(registers_[reg_code - 1])), CPU_EMPTY_REGISTER, this);
+    threads_[id].host.join();
 
-            ptr = (PTR_TYPE)(int)registers_[reg_code - 1];
-            CPU_ASSERTOK((isPOISON(ptr)), CPU_EMPTY_REGISTER, this);
-            CPU_ASSERTOK((ptr >= RAM_SIZE), CPU_WRONG_ADDR, this);
+    int err = threads_[id].cpu->result_;
+    if (err > 0) fault_ = threads_[id].cpu->fault_;
 
-            CPU_ASSERTOK((isPOISON(registers_[REG_SCRX - 1])), CPU_EMPTY_REGISTER, this);
-            CPU_ASSERTOK((isPOISON(registers_[REG_SCRY - 1])), CPU_EMPTY_REGISTER, this);
+    delete threads_[id].cpu;
+    threads_[id].cpu = nullptr;
 
-            width  = (int)(registers_[REG_SCRX - 1]);
-            height = (int)(registers_[REG_SCRY - 1]);
-            CPU_ASSERTOK(((width <= 0) || (height <= 0)), CPU_INCORRECT_WINDOW_SIZES, this);
-            CPU_ASSERTOK((ptr + width * height * PIXEL_SIZE > RAM_SIZE), CPU_NO_VIDEO_MEMORY, this);
+    return (err > 0) ? err : CPU_OK;
+}
 
-            DysplayVideoMem(window, width, height, ptr);
-            break;
-        }
-        default:
+//------------------------------------------------------------------------------
 
-            CPU_ASSERTOK(1, CPU_UNIDENTIFIED_COMMAND, this);
+int CPU::PopAtomicAddr (ptr_t* addr)
+{
+    assert(addr != nullptr);
 
-            return CPU_NOT_OK;
-        }
-    }
+    INT_TYPE num = 0;
+
+    int err = Pop1IntNumber(&num);
+    if (err) return err;
+
+    if ((num < 0) || (num + NUMBER_INT_SIZE > RAM_SIZE)) return CPU_WRONG_ADDR;
+    if (num % NUMBER_INT_SIZE != 0)                       return CPU_UNALIGNED_ATOMIC;
+
+    *addr = num;
 
     return CPU_OK;
 }
 
 //------------------------------------------------------------------------------
 
-void CPU::Pop1IntNumber (INT_TYPE* num)
+int CPU::Pop1IntNumber (INT_TYPE* num)
 {
     assert(num != nullptr);
 
     *num = stkCPU_INT_.Pop();
-    CPU_ASSERTOK((isPOISON(*num)), STACK_EMPTY_STACK, this);
+    if (isPOISON(*num)) return CPU_EMPTY_STACK;
+
+    return CPU_OK;
 }
 
 //------------------------------------------------------------------------------
 
-void CPU::Pop2IntNumbers (INT_TYPE* num1, INT_TYPE* num2)
+int CPU::Pop2IntNumbers (INT_TYPE* num1, INT_TYPE* num2)
 {
     assert(num1 != nullptr);
     assert(num2 != nullptr);
 
     *num1 = stkCPU_INT_.Pop();
-    CPU_ASSERTOK((isPOISON(*num1)), STACK_EMPTY_STACK, this);
+    if (isPOISON(*num1)) return CPU_EMPTY_STACK;
 
     *num2 = stkCPU_INT_.Pop();
-    CPU_ASSERTOK((isPOISON(*num2)), STACK_EMPTY_STACK, this);
+    if (isPOISON(*num2)) return CPU_EMPTY_STACK;
+
+    return CPU_OK;
 }
 
 //------------------------------------------------------------------------------
 
-void CPU::Pop1FloatNumber (FLT_TYPE* num)
+int CPU::Pop1FloatNumber (FLT_TYPE* num)
 {
     assert(num != nullptr);
 
     *num = stkCPU_FLT_.Pop();
-    CPU_ASSERTOK((isPOISON(*num)), STACK_EMPTY_STACK, this);
+    if (isPOISON(*num)) return CPU_EMPTY_STACK;
+
+    return CPU_OK;
 }
 
 //------------------------------------------------------------------------------
 
-void CPU::Pop2FloatNumbers(FLT_TYPE* num1, FLT_TYPE* num2)
+int CPU::Pop2FloatNumbers(FLT_TYPE* num1, FLT_TYPE* num2)
 {
     assert(num1 != nullptr);
     assert(num2 != nullptr);
 
     *num1 = stkCPU_FLT_.Pop();
-    CPU_ASSERTOK((isPOISON(*num1)), STACK_EMPTY_STACK, this);
+    if (isPOISON(*num1)) return CPU_EMPTY_STACK;
 
     *num2 = stkCPU_FLT_.Pop();
-    CPU_ASSERTOK((isPOISON(*num2)), STACK_EMPTY_STACK, this);
+    if (isPOISON(*num2)) return CPU_EMPTY_STACK;
+
+    return CPU_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void CPU::Fault (int err, const char* file, int line, const char* function, const CPU* p_cpu)
+{
+    state_ = err;
+
+    fault_.err      = err;
+    fault_.addr     = bcode_.ptr_;
+    fault_.file     = file;
+    fault_.line     = line;
+    fault_.function = function;
+
+    if (! log_) return;
+
+    CPUPrintError(CPU_LOGNAME, file, line, function, err);
+    if (p_cpu != nullptr) PrintCode(CPU_LOGNAME);
+
+    stkCPU_INT_.Dump(function, CPU_LOGNAME);
+    stkCPU_FLT_.Dump(function, CPU_LOGNAME);
+    stkCPU_PTR_.Dump(function, CPU_LOGNAME);
 }
 
 //------------------------------------------------------------------------------
 
-void CPU::DysplayVideoMem (sf::RenderWindow*& window, size_t width, size_t height, ptr_t ptr)
+int CPU::DysplayVideoMem (size_t width, size_t height, ptr_t ptr, int mode)
 {
+    const unsigned char* video = (const unsigned char*)RAM_ + ptr;
+    const unsigned char* rgb   = video;
+
+    // files and the handler take RGB, the window converts the video memory itself
+    if (mode != VIDEO_RGB888)
+    {
+        frame_.resize(width * height * PIXEL_SIZE);
+        ConvertToRGB(frame_.data(), video, width * height, mode);
+
+        rgb = frame_.data();
+    }
+
+    if (screen_func_ != nullptr)
+    {
+        int err = screen_func_(this, rgb, width, height, screen_data_);
+        if (err != CPU_OK) return CPU_SCREEN_FAILED;
+
+        ++screens_num_;
+        return CPU_OK;
+    }
+
     if (screens_num_ == 0)
     {
         filename_ = GetTrueFileName(filename_);
     }
-    else
+
+    // a cut name would write over the screens of another program, so it is an error
+    char pictname[MAX_NAME_LEN] = "";
+    int  len = snprintf(pictname, sizeof(pictname), "%s(%d)%s", (scrname_[0] != '\0') ? scrname_ : filename_,
+                        screens_num_, screen_types[screen_format_]);
+
+    if ((len < 0) || ((size_t)len >= sizeof(pictname))) return CPU_SCREEN_FAILED;
+
+    // the window saves only png in place, other screens are saved from RAM
+    bool encoded = headless_ || (screen_format_ != SCREEN_PNG) || (encoder_.getThreads() != 0) || (mode != VIDEO_RGB888);
+    bool saved   = true;
+
+#ifndef NO_SFML
+    if (! headless_)
+    {
+        PresentScreen(video, width, height, mode);
+
+        if (! encoded)
+        {
+            // the staging buffer is the image of the screen already
+            sf::Image screen;
+            screen.create(width, height, staging_.data());
+
+            saved = screen.saveToFile(pictname);
+        }
+    }
+#endif
+
+    if (encoded)
+    {
+        saved = (encoder_.getThreads() != 0) ? encoder_.Submit(pictname, screen_format_, rgb, width, height)
+                                             : WriteScreen(pictname, screen_format_, rgb, width, height);
+    }
+
+    ++screens_num_;
+
+    return (saved) ? CPU_OK : CPU_SCREEN_FAILED;
+}
+
+//------------------------------------------------------------------------------
+
+size_t CPU::getScreenSize (size_t width, size_t height, int mode) const
+{
+    // RGB copy of the screen
+    size_t video = (mode != VIDEO_RGB888) ? width * height * PIXEL_SIZE : 0;
+
+    if (screen_func_ != nullptr) return video;
+
+    // copies of the frames waiting for the encoders
+    if (encoder_.getThreads() != 0) video += (SCREEN_QUEUE_DEPTH + 1) * width * height * PIXEL_SIZE;
+
+    // headless screens go from RAM to the file without buffers
+    if (headless_) return video;
+
+#ifndef NO_SFML
+    // the staging buffer and the texture of the window
+    video += width * height * ((mode == VIDEO_RGBA8888) ? 1 : 2) * sizeof(sf::Uint32);
+#endif
+
+    return video;
+}
+
+//------------------------------------------------------------------------------
+
+#ifndef NO_SFML
+void CPU::PresentScreen (const unsigned char* video, size_t width, size_t height, int mode)
+{
+    if ((texture_ == nullptr) || (texture_->getSize().x != width) || (texture_->getSize().y != height))
+    {
+        CloseWindow();
+
+        window_  = new sf::RenderWindow(sf::VideoMode(width, height), "Program");
+        texture_ = new sf::Texture;
+        texture_->create(width, height);
+    }
+
+    // aligned RGBA8888 pixels are uploaded as they are, alpha of the program is not blended
+    bool direct = (mode == VIDEO_RGBA8888);
+
+    if (! direct)
     {
-        window->close();
-        delete window;
+        staging_.resize(width * height * 4);
+        ConvertToRGBA(staging_.data(), video, width * height, mode);
     }
 
-    window = new sf::RenderWindow(sf::VideoMode(width, height), "Program");
-    sf::VertexArray pointmap(sf::Points, width * height);
+    // the window closed by the user is not opened again, screens are still saved
+    if (! window_->isOpen()) return;
+
+    // threads of the program take screens in turn, so the context goes with the current one
+    window_->setActive(true);
 
-    for (int y = 0; y < height; ++y)
-    for (int x = 0; x < width;  ++x)
+    sf::Event event;
+    while (window_->pollEvent(event))
     {
-        pointmap[y*width + x].position = sf::Vector2f(x, y);
-        pointmap[y*width + x].color = sf::Color(RAM_[ptr + (y * width + x) * PIXEL_SIZE + 0],
-                                                RAM_[ptr + (y * width + x) * PIXEL_SIZE + 1],
-                                                RAM_[ptr + (y * width + x) * PIXEL_SIZE + 2] );
+        if (event.type == sf::Event::Closed)
+        {
+            // the context is released on every way out, another thread takes the next screen
+            window_->setActive(false);
+            window_->close();
+            return;
+        }
     }
 
-    window->draw(pointmap);
+    texture_->update((direct) ? video : staging_.data());
 
-    char pictname[256] = "";
-    char scrnumstr[8]  = "";
+    window_->clear();
+    window_->draw(sf::Sprite(*texture_), sf::BlendNone);
+    window_->display();
 
-    strcpy(pictname, filename_);
-    sprintf(scrnumstr, "%d", screens_num_);
-    strcat(pictname, "(");
-    strcat(pictname, scrnumstr);
-    strcat(pictname, ")");
-    strcat(pictname, ".png");
+    window_->setActive(false);
+}
 
-    sf::Texture screen;
-    screen.create(width, height);
-    screen.update(*window);
-    window->display();
+//------------------------------------------------------------------------------
 
-    screen.copyToImage().saveToFile(pictname);
+void CPU::CloseWindow ()
+{
+    if (window_ != nullptr) window_->close();
 
-    ++screens_num_;
+    delete texture_;
+    delete window_;
 
-    window->close();
-    delete window;
+    texture_ = nullptr;
+    window_  = nullptr;
 }
 
 //------------------------------------------------------------------------------
+#endif
 
 void CPU::PrintCode (const char* logname)
 {
@@ -651,20 +2571,20 @@ void CPU::PrintCode (const char* logname)
     --bcode_.ptr_;
 
     fprintf(log, " Address: %08lX\n\n", bcode_.ptr_);
-    printf (     " Address: %08lX\n\n", bcode_.ptr_);
+    fprintf(stderr, " Address: %08lX\n\n", bcode_.ptr_);
 
     fprintf(log, "//////////////////////////////////--CODE--//////////////////////////////////" "\n");
-    printf (     "//////////////////////////////////--CODE--//////////////////////////////////" "\n");
+    fprintf(stderr, "//////////////////////////////////--CODE--//////////////////////////////////" "\n");
 
     fprintf(log, "     Address ");
-    printf (     "     Address ");
+    fprintf(stderr, "     Address ");
     for (char i = 0; i < 0x10; ++i)
     {
         fprintf(log, "| %X ", i);
-        printf (     "| %X ", i);
+        fprintf(stderr, "| %X ", i);
     }
     fprintf(log, "\n");
-    printf (     "\n");
+    fprintf(stderr, "\n");
 
     size_t line      = bcode_.ptr_  - (bcode_.ptr_  % 0x10);
     size_t last_line = bcode_.size_ - (bcode_.size_ % 0x10);
@@ -674,31 +2594,31 @@ void CPU::PrintCode (const char* logname)
         if ((line + i >= 0) && (line + i <= last_line))
         {
             fprintf(log, "%s%s%08lX ", ((i == 0)? "=>" : "  "), "   ", line + i);
-            printf (     "%s%s%08lX ", ((i == 0)? "=>" : "  "), "   ", line + i);
+            fprintf(stderr, "%s%s%08lX ", ((i == 0)? "=>" : "  "), "   ", line + i);
 
             for (char byte = 0; byte < 0x10; ++byte)
             {
                 if (line + i + byte == bcode_.size_) break;
 
                 fprintf(log, "%02X  ", (unsigned char)bcode_.data_[line + i + byte]);
-                printf (     "%02X  ", (unsigned char)bcode_.data_[line + i + byte]);
+                fprintf(stderr, "%02X  ", (unsigned char)bcode_.data_[line + i + byte]);
             }
 
             fprintf(log, "\n");
-            printf (     "\n");
+            fprintf(stderr, "\n");
         }
     }
 
     for (int i = 0; i < 14 + 4*(bcode_.ptr_ % 0x10); ++i)
     {
         fprintf(log, "=");
-        printf (     "=");
+        fprintf(stderr, "=");
     }
     fprintf(log, "/\\\n");
-    printf (     "/\\\n");
+    fprintf(stderr, "/\\\n");
 
     fprintf(log, "////////////////////////////////////////////////////////////////////////////" "\n\n");
-    printf (     "////////////////////////////////////////////////////////////////////////////" "\n\n");
+    fprintf(stderr, "////////////////////////////////////////////////////////////////////////////" "\n\n");
 
     fclose(log);
 }
@@ -723,8 +2643,8 @@ void CPUPrintError(const char* logname, const char* file, int line, const char*
     fprintf(log, "ERROR: file %s  line %d  function %s\n\n", file, line, function);
     fprintf(log, "%s\n", cpu_errstr[err + 1]);
 
-    printf (     "ERROR: file %s  line %d  function %s\n",   file, line, function);
-    printf (     "%s\n\n", cpu_errstr[err + 1]);
+    fprintf(stderr, "ERROR: file %s  line %d  function %s\n",   file, line, function);
+    fprintf(stderr, "%s\n\n", cpu_errstr[err + 1]);
 
     fclose(log);
 }
@@ -30,14 +30,34 @@
 #endif
 
 
+// Build with -DNO_SFML to get the cpu without SFML, then screens are always saved headless.
+#ifndef NO_SFML
 #include <SFML/Graphics.hpp>
+#endif
+
+#include <thread>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <linux/openat2.h>
 
+#include "AsyncIO.h"
+#include "Image.h"
+#include "Module.h"
+#include "Screen.h"
 #include "../Commands.h"
 #include "../StringLib/StringLib.h"
 
 #define NO_DUMP
 #define NO_HASH
+#define NO_EXIT
 #include "../StackLib/Stack.h"
+#undef NO_EXIT
 #undef NO_HASH
 #undef NO_DUMP
 
@@ -57,10 +77,19 @@ enum CPUErrors
 
     CPU_DESTRUCTED                                                     ,
     CPU_DIVISION_BY_ZERO                                               ,
+    CPU_EMPTY_PROGRAM                                                  ,
     CPU_EMPTY_REGISTER                                                 ,
+    CPU_EMPTY_STACK                                                    ,
+    CPU_FILE_NOT_ALLOWED                                               ,
+    CPU_GUEST_FILE_ERROR                                               ,
+    CPU_HOST_CALL_FAILED                                               ,
     CPU_INCORRECT_INPUT                                                ,
     CPU_INCORRECT_WINDOW_SIZES                                         ,
+    CPU_MEMORY_LIMIT                                                   ,
+    CPU_MODULE_NOT_FOUND                                               ,
     CPU_NO_RET_ADDRESS                                                 ,
+    CPU_NO_SPACE_FOR_HOST_CALL                                         ,
+    CPU_NO_SPACE_FOR_MODULE                                            ,
     CPU_NO_SPACE_FOR_NUMBER_INT                                        ,
     CPU_NO_SPACE_FOR_NUMBER_FLT                                        ,
     CPU_NO_SPACE_FOR_POINTER                                           ,
@@ -68,10 +97,29 @@ enum CPUErrors
     CPU_NO_VIDEO_MEMORY                                                ,
     CPU_NULL_INPUT_CPU_PTR                                             ,
     CPU_NULL_INPUT_FILENAME                                            ,
+    CPU_RECORD_FILE_ERROR                                              ,
+    CPU_REPLAY_MISMATCH                                                ,
     CPU_ROOT_OF_A_NEG_NUMBER                                           ,
+    CPU_SCREEN_FAILED                                                  ,
+    CPU_SHARE_FILE_ERROR                                               ,
+    CPU_SHARED_RAM                                                     ,
+    CPU_SNAPSHOT_FILE_ERROR                                            ,
+    CPU_STACK_OVERFLOW                                                 ,
+    CPU_THREADS_RUNNING                                                ,
+    CPU_TOO_LONG_NAME                                                  ,
+    CPU_TOO_MANY_REQUESTS                                              ,
+    CPU_TOO_MANY_THREADS                                               ,
+    CPU_UNALIGNED_ATOMIC                                               ,
     CPU_UNIDENTIFIED_COMMAND                                           ,
     CPU_UNIDENTIFIED_REGISTER                                          ,
+    CPU_UNREGISTERED_HOST_CALL                                         ,
     CPU_WRONG_ADDR                                                     ,
+    CPU_WRONG_MODULE_NAME                                              ,
+    CPU_WRONG_NUM_VARIANT                                              ,
+    CPU_WRONG_REQUEST_ID                                               ,
+    CPU_WRONG_SNAPSHOT                                                 ,
+    CPU_WRONG_THREAD_ID                                                ,
+    CPU_WRONG_VIDEO_MODE                                               ,
 };
 
 char const * const cpu_errstr[] =
@@ -82,10 +130,19 @@ char const * const cpu_errstr[] =
 
     "CPU has already destructed"                                       ,
     "Division by zero"                                                 ,
+    "Program is empty"                                                 ,
     "Register is empty"                                                ,
+    "Stack is empty"                                                   ,
+    "File is outside the sandbox directory"                            ,
+    "Failed to read or write the file of the program"                  ,
+    "Host function failed"                                             ,
     "Incorrect input"                                                  ,
     "Incorrect window sizes received"                                  ,
+    "Memory limit of the cpu is exceeded"                              ,
+    "Code module is not found or is broken"                            ,
     "Function return address not found"                                ,
+    "Not enough space to determine the host function"                  ,
+    "Not enough space to determine the code module"                    ,
     "Not enough space to determine the int number"                     ,
     "Not enough space to determine the float number"                   ,
     "Not enough space to determine the pointer"                        ,
@@ -93,24 +150,44 @@ char const * const cpu_errstr[] =
     "No video memory"                                                  ,
     "The input value of the CPU pointer turned out to be zero"         ,
     "The input value of the CPU filename turned out to be zero"        ,
+    "Failed to read or write the input record"                         ,
+    "Input of the program does not match the record"                   ,
     "Root of a negative number"                                        ,
+    "Failed to save the screen"                                        ,
+    "Failed to create the shared memory for RAM"                       ,
+    "RAM is shared with other processes"                               ,
+    "Failed to read or write the snapshot file"                        ,
+    "Stack overflow"                                                   ,
+    "Guest threads are running"                                        ,
+    "Name of the program is too long"                                  ,
+    "Too many asynchronous I/O requests"                               ,
+    "Too many guest threads"                                           ,
+    "Atomic operation on an unaligned address"                         ,
     "Unidentified command"                                             ,
     "Unidentified register"                                            ,
+    "Host function is not registered"                                  ,
     "Memory access violation"                                          ,
+    "Module name can not be a path"                                    ,
+    "Program was assembled for another numeric variant"                ,
+    "Wrong asynchronous I/O request id"                                ,
+    "File is not a snapshot of this cpu"                               ,
+    "Wrong guest thread id"                                            ,
+    "Wrong video mode in the scrm register"                            ,
 };
 
 char const * const CPU_LOGNAME = "cpu.log";
 
-#define CPU_ASSERTOK(cond, err, p_cpu) if (cond)                                                             \
-                                       {                                                                     \
-                                         CPUPrintError(CPU_LOGNAME, __FILE__, __LINE__, __FUNC_NAME__, err); \
-                                         if (p_cpu != nullptr) PrintCode(CPU_LOGNAME);                       \
-                                         stkCPU_INT_.Dump(__FUNC_NAME__, CPU_LOGNAME);                       \
-                                         stkCPU_FLT_.Dump(__FUNC_NAME__, CPU_LOGNAME);                       \
-                                         stkCPU_PTR_.Dump(__FUNC_NAME__, CPU_LOGNAME);                       \
-                                         exit(err);                                                          \
+#define CPU_ASSERTOK(cond, err, p_cpu) if (cond)                                                    \
+                                       {                                                            \
+                                         Fault(err, __FILE__, __LINE__, __FUNC_NAME__, p_cpu);      \
+                                         return err;                                                \
                                        } //
 
+// a push that can not grow the stack faults the cpu instead of losing the value,
+// a push that would grow it over the memory limit faults before the memory is taken
+#define CPU_PUSH(stack, value) CPU_ASSERTOK((! CanPush(stack)),              CPU_MEMORY_LIMIT, this) \
+                               CPU_ASSERTOK((stack.Push(value) != STACK_OK), CPU_NO_MEMORY,    this)
+
 
 //==============================================================================
 /*------------------------------------------------------------------------------
@@ -119,9 +196,142 @@ char const * const CPU_LOGNAME = "cpu.log";
 //==============================================================================
 
 
-const double NIL        = 1e-7;
-const size_t RAM_SIZE   = 2097152; // 2 MB
-const size_t PIXEL_SIZE = 3;
+const double NIL            = 1e-7;
+const size_t RAM_SIZE       = 2097152; // 2 MB
+const size_t PIXEL_SIZE     = 3;
+const size_t MAX_THREADS    = 64;
+const size_t MAX_STACK_SIZE = MAX_CAPACITY / 2;
+const size_t MAX_NAME_LEN   = 256;
+
+const int PROCESS_PAUSED = -667;
+
+#ifdef NO_SFML
+const bool SCREEN_HEADLESS = true;
+#else
+const bool SCREEN_HEADLESS = false;
+#endif
+
+const size_t IO_BUFFER_SIZE = 1 << 20;
+
+enum IOModes
+{
+    IO_TEXT                                                            ,
+    IO_FAST                                                            ,
+    IO_BINARY                                                          ,
+};
+
+#define SNAP_SIGNATURE "PZSN"
+const char SNAP_VERSION = 3;
+
+// snapshot file: header, code, int, float and pointer stacks, RAM from a page boundary
+struct SnapHeader
+{
+    char     signature[4];
+    char     version;
+    char     variant;
+    char     reserved[2];
+
+    size_t   code_size;
+    size_t   ptr;
+    size_t   entry;
+    size_t   steps;
+    int      screens_num;
+
+    size_t   stack_size[3];
+    REG_TYPE registers[REG_NUM];
+
+    // a restored program writes its screens and finds its modules as before
+    char     progname[MAX_NAME_LEN];
+    char     moddir[MAX_NAME_LEN];
+
+    size_t   ram_offset;
+};
+
+#define CHECK_SIGNATURE "PZCP"
+const size_t CHECK_PAGE_SIZE = 4096;
+const size_t CHECK_PAGES_NUM = RAM_SIZE / CHECK_PAGE_SIZE;
+
+// checkpoint log record: header, code, int, float and pointer stacks, then the number and data of each page
+struct CheckHeader
+{
+    SnapHeader state;
+    size_t     pages_num;
+};
+
+#define RECORD_SIGNATURE "PZRC"
+const char RECORD_VERSION = 1;
+
+// input record: header, then the step (LEB128), the type ('i' or 'f') and the raw value of each number
+struct RecordHeader
+{
+    char signature[4];
+    char version;
+    char variant;
+    char reserved[2];
+};
+
+#define SHARE_SIGNATURE "PZSH"
+const char   SHARE_VERSION    = 1;
+const size_t SHARE_RAM_OFFSET = CHECK_PAGE_SIZE;
+
+// shared RAM: header with a ready marker of each page, RAM from the next page
+struct ShareHeader
+{
+    char   signature[4];
+    char   version;
+    char   variant;
+    char   reserved[2];
+
+    size_t ram_size;
+    size_t page_size;
+
+    // set when the cpu is gone and RAM is final
+    int    done;
+
+    unsigned char ready[CHECK_PAGES_NUM];
+};
+
+// memory of a cpu in bytes, reserved is allocated, touched is really backed by the host
+struct CPUMemory
+{
+    size_t ram_reserved    = 0;
+    size_t ram_touched     = 0;
+    size_t stacks_reserved = 0;
+    size_t stacks_touched  = 0;
+    size_t code            = 0;
+    bool   code_shared     = false;
+    size_t video           = 0;
+};
+
+struct CPUFault
+{
+    int         err      = CPU_OK;
+    size_t      addr     = 0;
+    const char* file     = nullptr;
+    int         line     = 0;
+    const char* function = nullptr;
+};
+
+class CPU;
+
+// host function takes its arguments from the stacks of the cpu and returns error code,
+// a cpu error faults the cpu with it, any other nonzero code with CPU_HOST_CALL_FAILED
+typedef int (*HostFunc) (CPU* cpu, void* data);
+
+// screen handler takes the screen instead of the file, pixels are in RAM and valid only during the call
+typedef int (*ScreenFunc) (CPU* cpu, const unsigned char* rgb, size_t width, size_t height, void* data);
+
+struct HostFunction
+{
+    HostFunc func = nullptr;
+    void*    data = nullptr;
+};
+
+struct GuestThread
+{
+    CPU*        cpu = nullptr;
+    std::thread host;
+};
 
 class CPU
 {
@@ -131,19 +341,100 @@ private:
     int screens_num_ = 0;
 
     char* filename_ = nullptr;
+    char  progname_[MAX_NAME_LEN] = "";
 
     BinCode bcode_;
 
-    char* RAM_ = nullptr;
+    // the code is borrowed from the image until the cpu changes it
+    std::shared_ptr<const ProgramImage> image_;
+
+    char*  RAM_      = nullptr;
+    char*  map_      = nullptr;
+    size_t map_size_ = 0;
+    int    image_fd_ = -1;
+    bool   ram_anon_ = false;
+
+    // screens are saved without a window, or given to the handler
+    bool       headless_    = SCREEN_HEADLESS;
+    ScreenFunc screen_func_ = nullptr;
+    void*      screen_data_ = nullptr;
+
+    // name of screen files, the program name when empty
+    char scrname_[MAX_NAME_LEN] = "";
+
+    // screens are encoded by the threads of the root while the program goes on
+    int          screen_format_ = SCREEN_PNG;
+    FrameEncoder encoder_;
+
+    // RGB copy of the screen in video modes other than RGB888
+    std::vector<unsigned char> frame_;
+
+#ifndef NO_SFML
+    // window lives with the cpu, screens go to its texture through the RGBA staging buffer
+    sf::RenderWindow*      window_  = nullptr;
+    sf::Texture*           texture_ = nullptr;
+    std::vector<sf::Uint8> staging_;
+#endif
+
+    // buffers of the last screen and the limit of stacks, code and screen buffers
+    size_t video_     = 0;
+    size_t mem_limit_ = 0;
+
+    // pages of RAM written after the last checkpoint, guest threads use the map of the root cpu
+    unsigned char  dirty_pages_[CHECK_PAGES_NUM + 1] = {};
+    unsigned char* dirty_ = dirty_pages_;
+
+    ShareHeader* share_ = nullptr;
+
+    bool deterministic_ = true;
 
     Stack<INT_TYPE> stkCPU_INT_;
     Stack<FLT_TYPE> stkCPU_FLT_;
     Stack<PTR_TYPE> stkCPU_PTR_;
 
-    FLT_TYPE registers_[REG_NUM] = {};
+    REG_TYPE registers_[REG_NUM] = {};
+
+    CPU*   parent_ = nullptr;
+    ptr_t  entry_  = 0;
+    int    result_ = CPU_OK;
+
+    GuestThread threads_[MAX_THREADS];
+    std::mutex  screen_lock_;
+
+    size_t   steps_ = 0;
+    CPUFault fault_;
+    bool     log_   = true;
+
+    FILE* in_  = stdin;
+    FILE* out_ = stdout;
+    int   io_mode_ = IO_TEXT;
+
+    FILE* record_ = nullptr;
+    FILE* replay_ = nullptr;
+
+    char sandbox_[MAX_NAME_LEN] = "";
+
+    // directory of the program with its code modules, and addresses of the loaded modules
+    char moddir_[MAX_NAME_LEN] = "";
+    std::unordered_map<std::string, ptr_t> modules_;
+
+    // requests of guest threads go to the root cpu, the cpu paused on await waits for one of them
+    AsyncIO aio_;
+    bool    waiting_ = false;
+
+    static HostFunction host_funcs_[HOST_FUNCS_NUM];
+
+    static std::mutex               cpus_lock_;
+    static std::unordered_set<CPU*> cpus_;
 
 public:
 
+//------------------------------------------------------------------------------
+/*! @brief   CPU constructor without a program, the program is loaded later by Load.
+ */
+
+    CPU ();
+
 //------------------------------------------------------------------------------
 /*! @brief   CPU constructor.
  *
@@ -152,6 +443,29 @@ public:
 
     CPU (char* filename);
 
+//------------------------------------------------------------------------------
+/*! @brief   CPU constructor from binary code in memory.
+ *
+ *  @note    The code is copied, so the buffer can be freed after the construction.
+ *
+ *  @param   data        Binary code
+ *  @param   size        Size of the binary code
+ *  @param   name        Name of the program used for screenshots
+ */
+
+    CPU (const char* data, size_t size, const char* name = "program");
+
+//------------------------------------------------------------------------------
+/*! @brief   CPU constructor from a shared program image.
+ *
+ *  @note    The code is not copied, cpus of one image share it.
+ *
+ *  @param   image       Program image
+ *  @param   name        Name of the program used for screenshots
+ */
+
+    CPU (std::shared_ptr<const ProgramImage> image, const char* name = "program");
+
 //------------------------------------------------------------------------------
 /*! @brief   CPU copy constructor (deleted).
  *
@@ -164,10 +478,121 @@ public:
 
 //------------------------------------------------------------------------------
 /*! @brief   CPU destructor.
+ *
+ *  @note    Waits for all guest threads that were spawned and not joined.
  */
 
    ~CPU ();
 
+//------------------------------------------------------------------------------
+/*! @brief   Load another program into the cpu and reset the cpu to the start.
+ *
+ *  @note    RAM and stacks are reused, RAM is zeroed, guest threads are joined.
+ *           The code is copied, so the buffer can be freed after the loading.
+ *
+ *  @param   data        Binary code
+ *  @param   size        Size of the binary code
+ *  @param   name        Name of the program used for screenshots
+ *
+ *  @return  error code
+ */
+
+    int Load (const char* data, size_t size, const char* name = "program");
+
+//------------------------------------------------------------------------------
+/*! @brief   Load a program from a shared image and reset the cpu to the start.
+ *
+ *  @note    The same as Load of a buffer, but the code is not copied.
+ *
+ *  @param   image       Program image
+ *  @param   name        Name of the program used for screenshots
+ *
+ *  @return  error code
+ */
+
+    int Load (std::shared_ptr<const ProgramImage> image, const char* name = "program");
+
+//------------------------------------------------------------------------------
+/*! @brief   Save the paused cpu to a snapshot file.
+ *
+ *  @note    The snapshot keeps the code, RAM, stacks, registers, position in the code,
+ *           counters of instructions and screenshots. Guest threads must be joined.
+ *
+ *  @param   filename    Name of the snapshot file
+ *
+ *  @return  error code
+ */
+
+    int Save (const char* filename);
+
+//------------------------------------------------------------------------------
+/*! @brief   Restore the cpu from a snapshot file, Run continues from the saved place.
+ *
+ *  @note    The file is mapped privately, RAM pages are read from the file only when
+ *           the program touches them, changes are not written back to the file.
+ *
+ *  @param   filename    Name of the snapshot file
+ *
+ *  @return  error code
+ */
+
+    int Restore (const char* filename);
+
+//------------------------------------------------------------------------------
+/*! @brief   Append the state of the paused cpu to a checkpoint log.
+ *
+ *  @note    Only pages of RAM written after the previous checkpoint are saved,
+ *           so the log has to be written from the start of the program or after
+ *           RestoreCheckpoint from the same log. Guest threads must be joined.
+ *
+ *  @param   filename    Name of the log file
+ *
+ *  @return  error code
+ */
+
+    int Checkpoint (const char* filename);
+
+//------------------------------------------------------------------------------
+/*! @brief   Restore the cpu by replaying a checkpoint log, Run continues from the last checkpoint.
+ *
+ *  @param   filename    Name of the log file
+ *
+ *  @return  error code
+ */
+
+    int RestoreCheckpoint (const char* filename);
+
+//------------------------------------------------------------------------------
+/*! @brief   Make a copy of the paused cpu that shares RAM pages until they are written.
+ *
+ *  @note    RAM of the cpu is moved to a memory file once, the cpu and all its clones
+ *           map it privately, so each of them pays only for the pages it writes.
+ *           Stacks, registers and the position in the code are copied, the code of
+ *           a program loaded from an image is shared with it.
+ *           Guest threads must be joined. The clone is deleted by the caller.
+ *
+ *  @param   clone       Pointer to the pointer to the new cpu
+ *
+ *  @return  error code
+ */
+
+    int Clone (CPU** clone);
+
+//------------------------------------------------------------------------------
+/*! @brief   Move RAM to a shared memory object or a file, so that other processes can map it.
+ *
+ *  @note    Names starting with '/' are POSIX shared memory objects, other names are files.
+ *           RAM starts at SHARE_RAM_OFFSET after a ShareHeader. The program marks finished
+ *           pages with the ready command, and the header is marked done when the cpu is gone.
+ *           A shared cpu can not be cloned, restoring a snapshot ends the sharing.
+ *
+ *  @param   name        Name of the shared memory object or the file
+ *
+ *  @return  error code
+ */
+
+    int Share (const char* name);
+
 //------------------------------------------------------------------------------
 /*! @brief   Execution process.
  *
@@ -180,45 +605,526 @@ public:
 
     int Execute ();
 
-/*------------------------------------------------------------------------------
-                   Private functions                                           *
-*///----------------------------------------------------------------------------
+//------------------------------------------------------------------------------
+/*! @brief   Continue execution for a limited number of instructions.
+ *
+ *  @note    After an error the cpu keeps it and does not execute anything,
+ *           after hlt the cpu stays on it. When the program is done, its queued
+ *           screens are saved before Run returns.
+ *
+ *  @param   steps       Maximum number of instructions, 0 means no limit
+ *
+ *  @return  PROCESS_PAUSED if the limit is reached, PROCESS_HALT on hlt,
+ *           CPU_OK at the end of the code, else error code
+ */
 
-private:
+    int Run (size_t steps = 0);
+
+//------------------------------------------------------------------------------
+/*! @brief   Check if the last Run paused on await of an unfinished request.
+ *
+ *  @return  1 if the cpu waits for its I/O, else 0
+ */
+
+    bool isWaiting () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Set the function called when an asynchronous request of the cpu is done.
+ *
+ *  @param   func        Function, nullptr to call nothing
+ *  @param   data        Pointer passed to the function
+ */
+
+    void setIONotify (AsyncNotify func, void* data = nullptr);
+
+//------------------------------------------------------------------------------
+/*! @brief   Get the last error of the cpu.
+ *
+ *  @return  error description, err is CPU_OK if there was no error
+ */
+
+    const CPUFault& getFault () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Get number of executed instructions.
+ *
+ *  @return  number of instructions
+ */
+
+    size_t getSteps () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Get number of screenshots made by the program.
+ *
+ *  @return  number of screenshots
+ */
+
+    int getScreensNum () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Check that the result of the program depends only on its code and input.
+ *
+ *  @note    The program stops being deterministic when it starts a guest thread.
+ *
+ *  @return  1 if the program is deterministic, else 0
+ */
+
+    bool isDeterministic () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Turn on or off printing of errors to the console and to the log file.
+ *
+ *  @param   log         1 to print errors, 0 to keep them silent
+ */
+
+    void setLogging (bool log);
+
+//------------------------------------------------------------------------------
+/*! @brief   Set streams for the in and out commands.
+ *
+ *  @param   in          Input stream, nullptr means stdin
+ *  @param   out         Output stream, nullptr means stdout
+ */
+
+    void setIO (FILE* in, FILE* out);
+
+//------------------------------------------------------------------------------
+/*! @brief   Set the format of numbers for the in and out commands.
+ *
+ *  @note    IO_TEXT prints prompts and formats numbers with printf and scanf, IO_FAST
+ *           has no prompts and puts one number per line in the shortest form, IO_BINARY
+ *           moves raw numbers in the byte order of the host (little-endian on x86).
+ *
+ *  @param   mode        IO_TEXT, IO_FAST or IO_BINARY
+ */
+
+    void setIOMode (int mode);
+
+//------------------------------------------------------------------------------
+/*! @brief   Record every number read by the in commands with the step it was read at.
+ *
+ *  @param   filename    Name of the record file
+ *
+ *  @return  error code
+ */
+
+    int Record (const char* filename);
+
+//------------------------------------------------------------------------------
+/*! @brief   Take numbers for the in commands from the record instead of the input.
+ *
+ *  @note    There are no prompts, and the program stops with CPU_REPLAY_MISMATCH
+ *           if it reads a number at another step or of another type than recorded.
+ *
+ *  @param   filename    Name of the record file
+ *
+ *  @return  error code
+ */
+
+    int Replay (const char* filename);
+
+//------------------------------------------------------------------------------
+/*! @brief   Set the directory with files for the fload and fstore commands.
+ *
+ *  @note    Without the directory the program can not use files.
+ *
+ *  @param   dir         Name of the directory, nullptr to forbid files
+ */
+
+    void setSandbox (const char* dir);
+
+//------------------------------------------------------------------------------
+/*! @brief   Register a host function for the hcall command.
+ *
+ *  @note    The table is shared by all cpus, so functions are registered before
+ *           any cpu runs. Codes below HCALL_USER are taken by the built in functions.
+ *           A program calling a function with side effects still counts as deterministic.
+ *
+ *  @param   code        Host function code
+ *  @param   func        Host function, nullptr to unregister
+ *  @param   data        Pointer passed to the function on each call
+ */
+
+    static void Register (unsigned char code, HostFunc func, void* data = nullptr);
+
+//------------------------------------------------------------------------------
+/*! @brief   Save screens to PNG files straight from RAM, without a window.
+ *
+ *  @note    The cpu built with NO_SFML is always headless.
+ *
+ *  @param   headless    1 to save screens without a window, 0 to draw them in a window
+ */
+
+    void setHeadless (bool headless);
+
+//------------------------------------------------------------------------------
+/*! @brief   Give screens to the handler instead of saving them to files.
+ *
+ *  @param   func        Screen handler, nullptr to save screens to files again
+ *  @param   data        Pointer passed to the handler on each screen
+ */
+
+    void setScreenHandler (ScreenFunc func, void* data = nullptr);
+
+//------------------------------------------------------------------------------
+/*! @brief   Set name of screen files, screens are saved as name(N).png.
+ *
+ *  @param   name        Name of screen files, empty name means the program name
+ */
+
+    void setScreenName (const char* name);
+
+//------------------------------------------------------------------------------
+/*! @brief   Set format of screen files and encode them in the background.
+ *
+ *  @note    Frames are copied from RAM to the queue and the program goes on, it waits
+ *           only when the queue is full. Execute returns after all frames are saved.
+ *
+ *  @param   format      SCREEN_PNG or SCREEN_QOI
+ *  @param   encoders    Number of encoder threads, 0 to save screens in place
+ */
+
+    void setScreenFormat (int format, size_t encoders = 0);
+
+//------------------------------------------------------------------------------
+/*! @brief   Get memory used by the cpu.
+ *
+ *  @note    RAM of guest threads belongs to the root cpu, so it is zero for them.
+ *
+ *  @return  reserved and touched memory
+ */
+
+    CPUMemory getMemory () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Limit memory of stacks, code and screen buffers of the cpu.
+ *
+ *  @note    The program stops with CPU_MEMORY_LIMIT when it needs more. RAM is not
+ *           counted, it has the fixed size. Guest threads get the limit of the parent.
+ *
+ *  @param   limit       Limit in bytes, 0 means no limit
+ */
+
+    void setMemoryLimit (size_t limit);
+
+//------------------------------------------------------------------------------
+/*! @brief   Print memory used by all cpus of the process.
+ *
+ *  @note    Code shared by several cpus is counted once.
+ *
+ *  @param   fp          Pointer to the output file
+ */
+
+    static void PrintMemory (FILE* fp);
 
 //------------------------------------------------------------------------------
 /*! @brief   Pop one int number from stack.
  * 
  *  @param   num         Pointer to the number
+ *
+ *  @return  error code
  */
 
-    void Pop1IntNumber (INT_TYPE* num);
+    int Pop1IntNumber (INT_TYPE* num);
 
 //------------------------------------------------------------------------------
-/*! @brief   Pop two int numbers from stack.
+/*! @brief   Pop one float number from stack.
  * 
- *  @param   num1        Pointer to the first number of stack (top of the stack)
- *  @param   num2        Pointer to the second number of stack
+ *  @param   num         Pointer to the number
+ *
+ *  @return  error code
  */
 
-    void Pop2IntNumbers (INT_TYPE* num1, INT_TYPE* num2);
+    int Pop1FloatNumber (FLT_TYPE* num);
 
 //------------------------------------------------------------------------------
-/*! @brief   Pop one float number from stack.
+/*! @brief   Push an int number to stack.
+ *
+ *  @param   num         Number
+ *
+ *  @return  error code, CPU_MEMORY_LIMIT if the stack can not grow over the memory limit
+ */
+
+    int PushIntNumber (INT_TYPE num);
+
+//------------------------------------------------------------------------------
+/*! @brief   Push a float number to stack.
+ *
+ *  @param   num         Number
+ *
+ *  @return  error code, CPU_MEMORY_LIMIT if the stack can not grow over the memory limit
+ */
+
+    int PushFloatNumber (FLT_TYPE num);
+
+//------------------------------------------------------------------------------
+/*! @brief   Get the guest memory for host functions.
+ *
+ *  @note    Writes through this pointer are not seen by checkpoints.
+ *
+ *  @return  pointer to RAM_SIZE bytes of the guest memory
+ */
+
+    char* getRAM ();
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   Execute instructions, the body of Run.
+ *
+ *  @param   steps       Maximum number of instructions, 0 means no limit
+ *
+ *  @return  same as Run
+ */
+
+    int RunSteps (size_t steps);
+
+//------------------------------------------------------------------------------
+/*! @brief   Allocate RAM and check the binary code, common part of the constructors.
+ *
+ *  @return  error code
+ */
+
+    int Init ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Check the binary code and reset registers and counters for the start.
+ *
+ *  @return  error code
+ */
+
+    int Reset ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Free RAM, allocated or mapped from a snapshot.
+ */
+
+    void FreeRAM ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Map zero RAM, its pages take host memory only after they are touched.
+ *
+ *  @return  error code
+ */
+
+    int AllocRAM ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Fill RAM with zeros, pages of an anonymous map are given back to the host.
+ */
+
+    void ClearRAM ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Get memory counted by the memory limit.
+ *
+ *  @return  size of stacks, own code and screen buffers in bytes
+ */
+
+    size_t getHeapSize () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Check that a push to the stack keeps the cpu within the memory limit.
+ *
+ *  @note    A full stack doubles its capacity on the next push.
+ *
+ *  @param   stack       Stack to push to
+ *
+ *  @return  true if the push does not exceed the limit
+ */
+
+    template <typename TYPE>
+    bool CanPush (const Stack<TYPE>& stack) const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Add the cpu to the cpus of the process or remove it.
+ *
+ *  @param   alive       1 to add, 0 to remove
+ */
+
+    void Track (bool alive);
+
+//------------------------------------------------------------------------------
+/*! @brief   Clone constructor.
+ *
+ *  @note    The origin is taken by reference, a pointer would make CPU(this, ...)
+ *           ambiguous with the thread constructor.
+ *
+ *  @param   origin      Cloned cpu
+ *  @param   image       Memory file with RAM of the cloned cpu
+ */
+
+    CPU (const CPU& origin, int image);
+
+//------------------------------------------------------------------------------
+/*! @brief   Move RAM to a memory file and map it privately, if it is not done yet.
+ *
+ *  @return  error code
+ */
+
+    int Freeze ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Forget the memory file, RAM is going to be changed.
+ */
+
+    void Thaw ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Fill the state part of a snapshot or checkpoint header.
+ *
+ *  @param   header      Pointer to the header
+ *  @param   signature   Signature of the file
+ */
+
+    void MakeSnapHeader (SnapHeader* header, const char* signature);
+
+//------------------------------------------------------------------------------
+/*! @brief   Take the program name and the module directory from a restored header.
+ *
+ *  @param   header      Pointer to the header
+ */
+
+    void RestoreNames (const SnapHeader* header);
+
+//------------------------------------------------------------------------------
+/*! @brief   Write code and stacks after a snapshot or checkpoint header.
+ *
+ *  @param   fp          Pointer to the file
+ */
+
+    void WriteState (FILE* fp);
+
+//------------------------------------------------------------------------------
+/*! @brief   Remember that the pages of RAM with the range are changed.
+ *
+ *  @param   addr        Address of the range in RAM
+ *  @param   len         Length of the range
+ */
+
+    void MarkDirty (ptr_t addr, size_t len);
+
+//------------------------------------------------------------------------------
+/*! @brief   Open a file of the sandbox directory.
+ *
+ *  @note    Name is a zero terminated string in RAM. Absolute names and names with ".."
+ *           are not allowed, symbolic links are not followed in any part of the name.
+ *
+ *  @param   name        Address of the file name in RAM
+ *  @param   flags       Flags of open
+ *  @param   fd          Pointer to the file descriptor
+ *
+ *  @return  error code
+ */
+
+    int OpenGuestFile (ptr_t name, int flags, int* fd);
+
+//------------------------------------------------------------------------------
+/*! @brief   Load the code module called by an lcall command.
+ *
+ *  @note    The module is added to the end of the code and the address in the command
+ *           is set to its start. The code is moved, so guest threads must not run.
+ *
+ *  @param   stub        Address of the lcall operand in the code
+ *  @param   target      Pointer to the address of the module
+ *
+ *  @return  error code
+ */
+
+    int LinkModule (ptr_t stub, ptr_t* target);
+
+//------------------------------------------------------------------------------
+/*! @brief   Read a number for the in commands from the input or the record.
+ *
+ *  @param   value       Pointer to the number
+ *  @param   type        'i' for int numbers, 'f' for float numbers
+ *
+ *  @return  error code
+ */
+
+    template <typename TYPE>
+    int Input (TYPE* value, char type);
+
+//------------------------------------------------------------------------------
+/*! @brief   Guest thread constructor.
+ *
+ *  @note    The thread gets its own operand stacks and a copy of the parent registers,
+ *           the RAM and the binary code are shared with the parent.
+ *
+ *  @param   parent      Pointer to the spawning cpu
+ *  @param   entry       Address in the code to start from
+ */
+
+    CPU (CPU* parent, ptr_t entry);
+
+//------------------------------------------------------------------------------
+/*! @brief   Start a guest thread at the address in the code.
+ *
+ *  @param   entry       Address in the code to start from
+ *  @param   id          Pointer to the guest thread id
+ *
+ *  @return  error code
+ */
+
+    int Spawn (ptr_t entry, INT_TYPE* id);
+
+//------------------------------------------------------------------------------
+/*! @brief   Wait for the guest thread to finish and free it.
+ *
+ *  @param   id          Guest thread id
+ *
+ *  @return  error code, the error of the guest thread if it failed
+ */
+
+    int Join (INT_TYPE id);
+
+//------------------------------------------------------------------------------
+/*! @brief   Pop a RAM address for an atomic operation from int stack.
+ *
+ *  @param   addr        Pointer to the RAM address aligned to the int number size
+ *
+ *  @return  error code
+ */
+
+    int PopAtomicAddr (ptr_t* addr);
+
+//------------------------------------------------------------------------------
+/*! @brief   Pop two int numbers from stack.
  * 
- *  @param   num         Pointer to the number
+ *  @param   num1        Pointer to the first number of stack (top of the stack)
+ *  @param   num2        Pointer to the second number of stack
+ *
+ *  @return  error code
  */
 
-    void Pop1FloatNumber (FLT_TYPE* num);
+    int Pop2IntNumbers (INT_TYPE* num1, INT_TYPE* num2);
 
 //------------------------------------------------------------------------------
 /*! @brief   Pop two float numbers from stack.
  * 
  *  @param   num1        Pointer to the first number of stack (top of the stack)
  *  @param   num2        Pointer to the second number of stack
+ *
+ *  @return  error code
+ */
+
+    int Pop2FloatNumbers (FLT_TYPE* num1, FLT_TYPE* num2);
+
+//------------------------------------------------------------------------------
+/*! @brief   Remember an error and print it if logging is on.
+ *
+ *  @param   err         Error code
+ *  @param   file        Name of the program file
+ *  @param   line        Number of line with an error
+ *  @param   function    Name of the function with an error
+ *  @param   p_cpu       Pointer to the cpu if the code section has to be printed, else nullptr
  */
 
-    void Pop2FloatNumbers (FLT_TYPE* num1, FLT_TYPE* num2);
+    void Fault (int err, const char* file, int line, const char* function, const CPU* p_cpu);
 
 //------------------------------------------------------------------------------
 /*! @brief   Prints a section of code with an error to the console and to the log file.
@@ -229,15 +1135,51 @@ private:
     void PrintCode (const char* logname);
 
 //------------------------------------------------------------------------------
-/*! @brief   Prints a section of code with an error to the console and to the log file.
- * 
- *  @param   window      Pointer to SFML window
+/*! @brief   Show the video memory and save it as a screenshot.
+ *
  *  @param   width       Window width
  *  @param   height      Window height
  *  @param   ptr         Pointer to video memory
+ *  @param   mode        Video mode
+ *
+ *  @return  error code
+ */
+
+    int DysplayVideoMem (size_t width, size_t height, ptr_t ptr, int mode);
+
+//------------------------------------------------------------------------------
+/*! @brief   Get memory of the buffers made for a screen.
+ *
+ *  @param   width       Window width
+ *  @param   height      Window height
+ *  @param   mode        Video mode
+ *
+ *  @return  size of the buffers in bytes
  */
 
-    void DysplayVideoMem (sf::RenderWindow*& window, size_t width, size_t height, ptr_t ptr);
+    size_t getScreenSize (size_t width, size_t height, int mode) const;
+
+#ifndef NO_SFML
+//------------------------------------------------------------------------------
+/*! @brief   Show the screen in the window, opens the window on the first screen.
+ *
+ *  @note    Pixels are left in the staging buffer as RGBA, RGBA8888 video memory
+ *           goes to the texture directly.
+ *
+ *  @param   video       Video memory
+ *  @param   width       Window width
+ *  @param   height      Window height
+ *  @param   mode        Video mode
+ */
+
+    void PresentScreen (const unsigned char* video, size_t width, size_t height, int mode);
+
+//------------------------------------------------------------------------------
+/*! @brief   Close the window and free its texture.
+ */
+
+    void CloseWindow ();
+#endif
 
 //------------------------------------------------------------------------------
 };
@@ -0,0 +1,83 @@
+/*------------------------------------------------------------------------------
+    * File:        Image.cpp                                                   *
+    * Description: Functions to sharing binary code of programs between cpus   *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Image.h"
+
+//------------------------------------------------------------------------------
+
+static std::mutex                                                   images_lock;
+static std::unordered_map<std::string, ImageFile>                   images_files;
+static std::unordered_map<hash_t, std::weak_ptr<const ProgramImage>> images_codes;
+
+//------------------------------------------------------------------------------
+
+std::shared_ptr<const ProgramImage> GetImage (const char* filename)
+{
+    assert(filename != nullptr);
+
+    struct stat info = {};
+    if ((stat(filename, &info) != 0) || (! S_ISREG(info.st_mode)) || (info.st_size == 0)) return nullptr;
+
+    std::lock_guard<std::mutex> guard(images_lock);
+
+    auto found = images_files.find(filename);
+    if (found != images_files.end())
+    {
+        const ImageFile& file = found->second;
+        std::shared_ptr<const ProgramImage> cached = file.image.lock();
+
+        // a file rewritten within a second has another mtime in nanoseconds or another inode
+        if ((cached != nullptr) && (file.dev  == info.st_dev)  && (file.mtime.tv_sec  == info.st_mtim.tv_sec)
+                                && (file.ino  == info.st_ino)  && (file.mtime.tv_nsec == info.st_mtim.tv_nsec)
+                                && (file.size == info.st_size))
+            return cached;
+    }
+
+    // entries of freed images are dropped, so that the cache does not grow with every file
+    for (auto it = images_files.begin(); it != images_files.end(); )
+    {
+        if (it->second.image.expired()) it = images_files.erase(it);
+        else                            ++it;
+    }
+    for (auto it = images_codes.begin(); it != images_codes.end(); )
+    {
+        if (it->second.expired()) it = images_codes.erase(it);
+        else                      ++it;
+    }
+
+    std::shared_ptr<ProgramImage> image(new (std::nothrow) ProgramImage(filename));
+    if ((image == nullptr) || (image->code.data_ == nullptr)) return nullptr;
+
+    image->variant = GetBinVariant(image->code.data_, image->code.size_);
+    if (image->variant == NUM_VARIANT) image->code.size_ = CutBinHeader(image->code.data_, image->code.size_);
+
+    image->hash = fast_hash(image->code.data_, image->code.size_, image->variant);
+
+    // a copy of the program under another name uses the image that is already in memory
+    std::shared_ptr<const ProgramImage> same = images_codes[image->hash].lock();
+
+    if ((same == nullptr) || (same->variant != image->variant) || (same->code.size_ != image->code.size_) ||
+        (memcmp(same->code.data_, image->code.data_, image->code.size_) != 0))
+    {
+        same = image;
+        images_codes[image->hash] = same;
+    }
+
+    ImageFile& file = images_files[filename];
+    file.image = same;
+    file.dev   = info.st_dev;
+    file.ino   = info.st_ino;
+    file.mtime = info.st_mtim;
+    file.size  = info.st_size;
+
+    return same;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,70 @@
+/*------------------------------------------------------------------------------
+    * File:        Image.h                                                     *
+    * Description: Declaration of functions and data types used for sharing    *
+                   binary code of programs between cpus                        *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef IMAGE_H_INCLUDED
+#define IMAGE_H_INCLUDED
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/stat.h>
+
+#include "../Commands.h"
+#include "../StringLib/StringLib.h"
+#include "../StackLib/hash.h"
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Image constants and types                                   *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+// binary code of a program, it is never changed after loading, so cpus run it without copying
+struct ProgramImage
+{
+    BinCode code;              // without the binary header
+    hash_t  hash    = 0;       // fast hash of the code
+    int     variant = -1;      // numeric variant from the binary header
+
+    ProgramImage (const char* filename) : code (filename) {}
+};
+
+// file the image was loaded from, the image is loaded again when the file changes;
+// the cache does not own images, they are kept by the cpus that run them
+struct ImageFile
+{
+    std::weak_ptr<const ProgramImage> image;
+    dev_t    dev   = 0;
+    ino_t    ino   = 0;
+    timespec mtime = {};
+    off_t    size  = 0;
+};
+
+
+//------------------------------------------------------------------------------
+/*! @brief   Get the image of a binary code file from the cache or from the file.
+ *
+ *  @note    Files with the same code share one image while any cpu uses it. An image
+ *           nobody uses is freed, its entries are dropped on the next load.
+ *
+ *  @param   filename    Name of the binary code file
+ *
+ *  @return  pointer to the image, nullptr if the file is not found or is empty
+ */
+
+std::shared_ptr<const ProgramImage> GetImage (const char* filename);
+
+//------------------------------------------------------------------------------
+
+#endif //IMAGE_H_INCLUDED
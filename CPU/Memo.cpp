@@ -0,0 +1,255 @@
+/*------------------------------------------------------------------------------
+    * File:        Memo.cpp                                                    *
+    * Description: Functions to caching results of deterministic programs      *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Memo.h"
+
+//------------------------------------------------------------------------------
+
+Memo::Memo (const char* dir, int format) :
+    state_  (MEMO_OK),
+    format_ ((format == SCREEN_QOI) ? SCREEN_QOI : SCREEN_PNG)
+{
+    if (dir == nullptr)
+    {
+        state_ = MEMO_NULL_INPUT_FILENAME;
+        return;
+    }
+
+    // a cut name would share the cache with another directory
+    if (strlen(dir) > MAX_NAME_LEN / 2)
+    {
+        state_ = MEMO_TOO_LONG_DIR_NAME;
+        return;
+    }
+
+    strcpy(dir_, dir);
+
+    if (! MakeDir(dir_)) state_ = MEMO_CACHE_DIR_ERROR;
+}
+
+//------------------------------------------------------------------------------
+
+Memo::~Memo ()
+{
+    assert(this != nullptr);
+
+    state_ = MEMO_NOT_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int Memo::Run (char* filename, int* result)
+{
+    MEMO_ASSERTOK((this == nullptr),                          MEMO_NULL_INPUT_MEMO_PTR);
+    MEMO_ASSERTOK(((filename == nullptr) || (result == nullptr)), MEMO_NULL_INPUT_FILENAME);
+    MEMO_ASSERTOK(state_, state_);
+
+    FILE* fp = fopen(filename, "rb");
+    size_t code_size = (fp == nullptr) ? 0 : CountSize(fp);
+    if (fp != nullptr) fclose(fp);
+    MEMO_ASSERTOK((code_size == 0), MEMO_NO_PROGRAM_FILE);
+
+    BinCode bcode(filename);
+
+    char*  input     = nullptr;
+    size_t input_len = 0;
+
+    FILE* in = open_memstream(&input, &input_len);
+    MEMO_ASSERTOK((in == nullptr), MEMO_NO_MEMORY);
+
+    char buffer[BUFSIZ] = "";
+    for (size_t num = 0; (num = fread(buffer, 1, BUFSIZ, stdin)) != 0; ) fwrite(buffer, 1, num, in);
+    fclose(in);
+
+    hash_t key_hash = fast_hash(input, input_len, fast_hash(bcode.data_, bcode.size_));
+
+    // the directory takes at most half of the name, so the key always fits
+    char key[MAX_NAME_LEN] = "";
+    snprintf(key, MAX_NAME_LEN, "%s/%016llX", dir_, (unsigned long long)key_hash);
+
+    // screenshots of the cpu are named after the true name of the binary file
+    char pictname[MAX_NAME_LEN] = "";
+    strncpy(pictname, filename, MAX_NAME_LEN - 1);
+    strcpy(pictname, GetTrueFileName(pictname));
+
+    if (Load(key, bcode, input, input_len, pictname, result))
+    {
+        free(input);
+        return MEMO_OK;
+    }
+
+    char*  output     = nullptr;
+    size_t output_len = 0;
+
+    // the terminating zero is readable, so that an empty input is not an empty buffer
+    in        = fmemopen(input, input_len + 1, "r");
+    FILE* out = open_memstream(&output, &output_len);
+
+    if ((in == nullptr) || (out == nullptr))
+    {
+        if (in  != nullptr) fclose(in);
+        if (out != nullptr) fclose(out);
+        free(input);
+    }
+    MEMO_ASSERTOK(((in == nullptr) || (out == nullptr)), MEMO_NO_MEMORY);
+
+    bool deterministic = false;
+    int  screens_num   = 0;
+    {
+        CPU cpu(bcode.data_, bcode.size_, filename);
+        cpu.setIO(in, out);
+        if (format_ != SCREEN_PNG) cpu.setScreenFormat(format_);
+
+        *result = cpu.Execute();
+
+        deterministic = cpu.isDeterministic();
+        screens_num   = cpu.getScreensNum();
+    }
+
+    fclose(in);
+    fclose(out);
+
+    fwrite(output, 1, output_len, stdout);
+
+    if (deterministic && (*result <= 0))
+        Store(key, bcode, input, input_len, output, output_len, pictname, screens_num, *result);
+
+    free(output);
+    free(input);
+
+    return MEMO_OK;
+}
+
+//------------------------------------------------------------------------------
+
+bool Memo::Load (const char* key, const BinCode& bcode, const char* input, size_t input_len, const char* pictname, int* result)
+{
+    char entry[MAX_NAME_LEN] = "";
+    snprintf(entry, MAX_NAME_LEN, "%s%s", key, MEMO_TYPE);
+
+    FILE* fp = fopen(entry, "rb");
+    if (fp == nullptr) return 0;
+
+    MemoHeader header = {};
+    bool found = (fread(&header, sizeof(MemoHeader), 1, fp) == 1)                         &&
+                 (memcmp(header.signature, MEMO_SIGNATURE, sizeof(header.signature)) == 0) &&
+                 (header.code_size == bcode.size_) && (header.input_len == input_len)     &&
+                 (header.screen_format == format_);
+
+    char* data = nullptr;
+    if (found)
+    {
+        size_t size = header.code_size + header.input_len + header.output_len;
+
+        data  = (char*)calloc(size + 1, 1);
+        found = (data != nullptr) && (fread(data, 1, size, fp) == size)                &&
+                (memcmp(data, bcode.data_, bcode.size_) == 0)                          &&
+                (memcmp(data + header.code_size, input, input_len) == 0);
+    }
+
+    fclose(fp);
+
+    char from[MAX_NAME_LEN] = "";
+    char to  [MAX_NAME_LEN] = "";
+
+    for (int i = 0; found && (i < header.screens_num); ++i)
+    {
+        found = SetScreenName(from, key, i) && SetScreenName(to, pictname, i) && CopyFile(from, to);
+    }
+
+    if (found)
+    {
+        fwrite(data + header.code_size + header.input_len, 1, header.output_len, stdout);
+        *result = header.result;
+    }
+
+    free(data);
+
+    return found;
+}
+
+//------------------------------------------------------------------------------
+
+void Memo::Store (const char* key, const BinCode& bcode, const char* input, size_t input_len,
+                  const char* output, size_t output_len, const char* pictname, int screens_num, int result)
+{
+    char from[MAX_NAME_LEN] = "";
+    char to  [MAX_NAME_LEN] = "";
+
+    for (int i = 0; i < screens_num; ++i)
+    {
+        if (! (SetScreenName(from, pictname, i) && SetScreenName(to, key, i) && CopyFile(from, to))) return;
+    }
+
+    MemoHeader header = {};
+    memcpy(header.signature, MEMO_SIGNATURE, sizeof(header.signature));
+    header.result      = result;
+    header.screens_num   = screens_num;
+    header.screen_format = format_;
+    header.code_size   = bcode.size_;
+    header.input_len   = input_len;
+    header.output_len  = output_len;
+
+    // the entry appears only when it is complete, so a parallel run never reads a half of it
+    char temp [MAX_NAME_LEN] = "";
+    char entry[MAX_NAME_LEN] = "";
+    snprintf(temp,  MAX_NAME_LEN, "%s.%d.tmp", key, getpid());
+    snprintf(entry, MAX_NAME_LEN, "%s%s",      key, MEMO_TYPE);
+
+    FILE* fp = fopen(temp, "wb");
+    if (fp == nullptr) return;
+
+    fwrite(&header,     sizeof(MemoHeader), 1, fp);
+    fwrite(bcode.data_, 1, bcode.size_,        fp);
+    fwrite(input,       1, input_len,          fp);
+    fwrite(output,      1, output_len,         fp);
+
+    bool err = (fflush(fp) != 0) || ferror(fp);
+    fclose(fp);
+
+    if (err || (rename(temp, entry) != 0)) remove(temp);
+}
+
+//------------------------------------------------------------------------------
+
+bool Memo::SetScreenName (char* name, const char* base, int num)
+{
+    int len = snprintf(name, MAX_NAME_LEN, "%s(%d)%s", base, num, screen_types[format_]);
+
+    return (len >= 0) && ((size_t)len < MAX_NAME_LEN);
+}
+
+//------------------------------------------------------------------------------
+
+void MemoPrintError(const char* logname, const char* file, int line, const char* function, int err)
+{
+    assert(function != nullptr);
+    assert(logname  != nullptr);
+    assert(file     != nullptr);
+
+    FILE* log = fopen(logname, "a");
+    assert(log != nullptr);
+
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+
+    fprintf(log, "###############################################################################\n");
+    fprintf(log, "TIME: %d-%02d-%02d %02d:%02d:%02d\n\n",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    fprintf(log, "ERROR: file %s  line %d  function %s\n\n", file, line, function);
+    fprintf(log, "%s\n", memo_errstr[err + 1]);
+
+    printf (     "ERROR: file %s  line %d  function %s\n",   file, line, function);
+    printf (     "%s\n\n", memo_errstr[err + 1]);
+
+    fclose(log);
+}
+
+//------------------------------------------------------------------------------
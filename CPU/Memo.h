@@ -0,0 +1,204 @@
+/*------------------------------------------------------------------------------
+    * File:        Memo.h                                                      *
+    * Description: Declaration of functions and data types used for caching    *
+                   results of deterministic programs                           *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef MEMO_H_INCLUDED
+#define MEMO_H_INCLUDED
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CPU.h"
+#include "../StackLib/hash.h"
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Memo errors                                                 *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+enum MemoErrors
+{
+    MEMO_NOT_OK = -1                                                   ,
+    MEMO_OK = 0                                                        ,
+    MEMO_NO_MEMORY                                                     ,
+
+    MEMO_CACHE_DIR_ERROR                                               ,
+    MEMO_NO_PROGRAM_FILE                                               ,
+    MEMO_NULL_INPUT_FILENAME                                           ,
+    MEMO_NULL_INPUT_MEMO_PTR                                           ,
+    MEMO_TOO_LONG_DIR_NAME                                         ,
+};
+
+char const * const memo_errstr[] =
+{
+    "ERROR"                                                            ,
+    "OK"                                                               ,
+    "Failed to allocate memory"                                        ,
+
+    "Failed to create the cache directory"                             ,
+    "Binary code file is not found or empty"                           ,
+    "The input value of the memo filename turned out to be zero"       ,
+    "The input value of the memo pointer turned out to be zero"        ,
+    "Name of the cache directory is too long"                      ,
+};
+
+#define MEMO_ASSERTOK(cond, err) if (cond)                                                              \
+                                 {                                                                      \
+                                   MemoPrintError(CPU_LOGNAME, __FILE__, __LINE__, __FUNC_NAME__, err); \
+                                   return err;                                                          \
+                                 } //
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Memo constants and types                                    *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+#define MEMO_SIGNATURE "PZMO"
+char const * const MEMO_TYPE = ".memo";
+
+// cache entry: header, code, input, output; code and input are kept to tell apart equal hashes
+struct MemoHeader
+{
+    char   signature[4];
+    int    result;
+    int    screens_num;
+    int    screen_format;
+    size_t code_size;
+    size_t input_len;
+    size_t output_len;
+};
+
+class Memo
+{
+private:
+
+    int state_;
+    int format_ = SCREEN_PNG;
+
+    char dir_[MAX_NAME_LEN] = "";
+
+public:
+
+//------------------------------------------------------------------------------
+/*! @brief   Memo constructor.
+ *
+ *  @param   dir         Name of the cache directory, it is created with its parents if there is no such
+ *  @param   format      Format of the screenshots, SCREEN_PNG or SCREEN_QOI
+ *
+ *  @note    The directory name takes at most half of MAX_NAME_LEN, the rest is left for the entries.
+ */
+
+    Memo (const char* dir, int format = SCREEN_PNG);
+
+//------------------------------------------------------------------------------
+/*! @brief   Memo copy constructor (deleted).
+ *
+ *  @param   obj         Source memo
+ */
+
+    Memo (const Memo& obj);
+
+    Memo& operator = (const Memo& obj); // deleted
+
+//------------------------------------------------------------------------------
+/*! @brief   Memo destructor.
+ */
+
+   ~Memo ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Execute the program with the whole stdin as input or take its result from the cache.
+ *
+ *  @note    The key of the cache is the hash of the code and the input. The output
+ *           and screenshots are stored only if the program finished without errors
+ *           and stayed deterministic.
+ *
+ *  @param   filename    Name of a binary code file
+ *  @param   result      Pointer to the result of the program
+ *
+ *  @return  error code
+ */
+
+    int Run (char* filename, int* result);
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   Print the cached output and copy the screenshots if the entry matches.
+ *
+ *  @param   key         Name of the cache entry without type
+ *  @param   bcode       Binary code of the program
+ *  @param   input       Input of the program
+ *  @param   input_len   Length of the input
+ *  @param   pictname    Name of the screenshots without number
+ *  @param   result      Pointer to the result of the program
+ *
+ *  @return  1 if the entry is found, else 0
+ */
+
+    bool Load (const char* key, const BinCode& bcode, const char* input, size_t input_len, const char* pictname, int* result);
+
+//------------------------------------------------------------------------------
+/*! @brief   Store the output and the screenshots to the cache.
+ *
+ *  @param   key         Name of the cache entry without type
+ *  @param   bcode       Binary code of the program
+ *  @param   input       Input of the program
+ *  @param   input_len   Length of the input
+ *  @param   output      Output of the program
+ *  @param   output_len  Length of the output
+ *  @param   pictname    Name of the screenshots without number
+ *  @param   screens_num Number of the screenshots
+ *  @param   result      Result of the program
+ */
+
+    void Store (const char* key, const BinCode& bcode, const char* input, size_t input_len,
+                const char* output, size_t output_len, const char* pictname, int screens_num, int result);
+
+//------------------------------------------------------------------------------
+/*! @brief   Make the name of a screenshot in the format of the memo.
+ *
+ *  @param   name        Buffer of MAX_NAME_LEN chars for the name
+ *  @param   base        Name of the screenshots without number
+ *  @param   num         Number of the screenshot
+ *
+ *  @return  0 if the name does not fit, else 1
+ */
+
+    bool SetScreenName (char* name, const char* base, int num);
+
+//------------------------------------------------------------------------------
+};
+
+//------------------------------------------------------------------------------
+/*! @brief   Prints an error wih description to the console and to the log file.
+ *
+ *  @param   logname     Name of the log file
+ *  @param   file        Name of the program file
+ *  @param   line        Number of line with an error
+ *  @param   function    Name of the function with an error
+ *  @param   err         Error code
+ */
+
+void MemoPrintError (const char* logname, const char* file, int line, const char* function, int err);
+
+//------------------------------------------------------------------------------
+
+#endif //MEMO_H_INCLUDED
@@ -0,0 +1,61 @@
+/*------------------------------------------------------------------------------
+    * File:        Module.cpp                                                  *
+    * Description: Functions to loading code modules of programs on the first  *
+                   call                                                        *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Module.h"
+
+//------------------------------------------------------------------------------
+
+bool RelocateModule (char* code, size_t size, ptr_t base)
+{
+    assert(code != nullptr);
+
+    for (size_t ptr = 0; ptr < size; )
+    {
+        unsigned char cmd_code = code[ptr++];
+        size_t        len      = 0;
+
+        if ((cmd_code & PTR_FLAG) && (cmd_code & REG_FLAG) && (cmd_code & NUM_FLAG))
+            len = 1 + NUMBER_INT_SIZE;
+
+        else if ((cmd_code & PTR_FLAG) && (cmd_code & NUM_FLAG))
+            len = POINTER_SIZE;
+
+        else if (isJUMP(cmd_code))
+        {
+            if (size - ptr < POINTER_SIZE) return 0;
+
+            *(ptr_t*)(code + ptr) += base;
+            len = POINTER_SIZE;
+        }
+        else if ((cmd_code & REG_FLAG) || (cmd_code == CMD_SCREEN) || (cmd_code == CMD_HCALL))
+            len = 1;
+
+        else if (cmd_code == (CMD_PUSHQ | NUM_FLAG))
+            len = NUMBER_FLT_SIZE;
+
+        else if (cmd_code == (CMD_PUSH | NUM_FLAG))
+            len = NUMBER_INT_SIZE;
+
+        else if (cmd_code == CMD_LCALL)
+        {
+            if (size - ptr < POINTER_SIZE + 1) return 0;
+
+            len = POINTER_SIZE + 1 + (unsigned char)code[ptr + POINTER_SIZE];
+        }
+
+        if (size - ptr < len) return 0;
+        ptr += len;
+    }
+
+    return 1;
+}
+
+//------------------------------------------------------------------------------
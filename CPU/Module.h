@@ -0,0 +1,45 @@
+/*------------------------------------------------------------------------------
+    * File:        Module.h                                                    *
+    * Description: Declaration of functions and data types used for loading    *
+                   code modules of programs on the first call                  *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef MODULE_H_INCLUDED
+#define MODULE_H_INCLUDED
+
+#include "Image.h"
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Module constants and types                                  *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+char const * const MODULE_TYPE = ".bin";
+
+
+//------------------------------------------------------------------------------
+/*! @brief   Move the code of a module to another address.
+ *
+ *  @note    Addresses of jumps and calls in the module start from zero, so the base
+ *           address is added to each of them.
+ *
+ *  @param   code        Module code
+ *  @param   size        Size of the module code
+ *  @param   base        Address of the module in the program code
+ *
+ *  @return  1 if relocated, 0 if the code is broken
+ */
+
+bool RelocateModule (char* code, size_t size, ptr_t base);
+
+//------------------------------------------------------------------------------
+
+#endif //MODULE_H_INCLUDED
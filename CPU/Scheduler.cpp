@@ -0,0 +1,238 @@
+/*------------------------------------------------------------------------------
+    * File:        Scheduler.cpp                                               *
+    * Description: Functions to running many cpus on a few worker threads      *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Scheduler.h"
+
+//------------------------------------------------------------------------------
+
+Scheduler::Scheduler (size_t workers, size_t budget) :
+    state_       (SCHED_OK),
+    workers_num_ (workers),
+    budget_      (budget),
+    pending_     (0),
+    next_queue_  (0)
+{
+    if (workers_num_ == 0) workers_num_ = std::thread::hardware_concurrency();
+    if (workers_num_ == 0) workers_num_ = 1;
+    if (budget_      == 0) budget_      = DEFAULT_BUDGET;
+
+    queues_ = new (std::nothrow) SchedQueue[workers_num_];
+    if (queues_ == nullptr) state_ = SCHED_NO_MEMORY;
+}
+
+//------------------------------------------------------------------------------
+
+Scheduler::~Scheduler ()
+{
+    assert(this != nullptr);
+
+    if (state_ == SCHED_DESTRUCTED) return;
+
+    delete [] queues_;
+    queues_ = nullptr;
+
+    state_ = SCHED_DESTRUCTED;
+}
+
+//------------------------------------------------------------------------------
+
+int Scheduler::Add (SchedTask* task)
+{
+    SCHED_ASSERTOK((this == nullptr), SCHED_NULL_INPUT_SCHEDULER_PTR);
+    SCHED_ASSERTOK((task == nullptr), SCHED_NULL_INPUT_TASK_PTR);
+    SCHED_ASSERTOK((task->cpu == nullptr), SCHED_NULL_INPUT_TASK_PTR);
+    SCHED_ASSERTOK(state_, state_);
+
+    task->result    = PROCESS_PAUSED;
+    task->scheduler = this;
+    task->home      = next_queue_++ % workers_num_;
+    task->parked    = false;
+    task->io_done   = false;
+
+    task->cpu->setIONotify(&Scheduler::Wake, task);
+
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        ++pending_;
+    }
+
+    Push(task->home, task);
+
+    return SCHED_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int Scheduler::Run ()
+{
+    SCHED_ASSERTOK((this == nullptr), SCHED_NULL_INPUT_SCHEDULER_PTR);
+    SCHED_ASSERTOK(state_, state_);
+
+    std::thread* pool = new (std::nothrow) std::thread[workers_num_];
+    SCHED_ASSERTOK((pool == nullptr), SCHED_NO_MEMORY);
+
+    for (size_t i = 0; i < workers_num_; ++i)
+    {
+        pool[i] = std::thread(&Scheduler::Worker, this, i);
+    }
+
+    for (size_t i = 0; i < workers_num_; ++i)
+    {
+        pool[i].join();
+    }
+
+    delete [] pool;
+
+    return SCHED_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void Scheduler::Worker (size_t id)
+{
+    while (true)
+    {
+        // wakes are counted before the queues are looked at, so that a task queued meanwhile is not missed
+        size_t seen = 0;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (pending_ == 0) return;
+
+            seen = wakes_;
+        }
+
+        SchedTask* task = Take(id);
+        if (task == nullptr)
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            ready_.wait(guard, [&]{ return (wakes_ != seen) || (pending_ == 0); });
+            continue;
+        }
+
+        int result = task->cpu->Run(budget_);
+
+        if (result != PROCESS_PAUSED)
+        {
+            task->cpu->setIONotify(nullptr);
+            task->result = result;
+
+            std::lock_guard<std::mutex> guard(lock_);
+            --pending_;
+            ready_.notify_all();
+            continue;
+        }
+
+        if (task->cpu->isWaiting())
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+
+            // the request may be done already, then the task goes on at once
+            task->parked  = ! task->io_done;
+            task->io_done = false;
+
+            if (task->parked) continue;
+        }
+
+        Push(id, task);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Scheduler::Push (size_t id, SchedTask* task)
+{
+    {
+        std::lock_guard<std::mutex> guard(queues_[id].lock);
+        queues_[id].tasks.push_back(task);
+    }
+
+    std::lock_guard<std::mutex> guard(lock_);
+    ++wakes_;
+    ready_.notify_one();
+}
+
+//------------------------------------------------------------------------------
+
+void Scheduler::Wake (void* data)
+{
+    SchedTask* task      = (SchedTask*)data;
+    Scheduler* scheduler = task->scheduler;
+
+    {
+        std::lock_guard<std::mutex> guard(scheduler->lock_);
+
+        if (! task->parked)
+        {
+            task->io_done = true;
+            return;
+        }
+
+        task->parked = false;
+    }
+
+    scheduler->Push(task->home, task);
+}
+
+//------------------------------------------------------------------------------
+
+SchedTask* Scheduler::Take (size_t id)
+{
+    SchedTask* task = nullptr;
+
+    for (size_t i = 0; (i < workers_num_) && (task == nullptr); ++i)
+    {
+        SchedQueue* queue = queues_ + (id + i) % workers_num_;
+
+        std::lock_guard<std::mutex> guard(queue->lock);
+        if (queue->tasks.empty()) continue;
+
+        // the own queue is taken from the front, the others are robbed from the back
+        if (i == 0)
+        {
+            task = queue->tasks.front();
+            queue->tasks.pop_front();
+        }
+        else
+        {
+            task = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+    }
+
+    return task;
+}
+
+//------------------------------------------------------------------------------
+
+void SchedPrintError(const char* logname, const char* file, int line, const char* function, int err)
+{
+    assert(function != nullptr);
+    assert(logname  != nullptr);
+    assert(file     != nullptr);
+
+    FILE* log = fopen(logname, "a");
+    assert(log != nullptr);
+
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+
+    fprintf(log, "###############################################################################\n");
+    fprintf(log, "TIME: %d-%02d-%02d %02d:%02d:%02d\n\n",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    fprintf(log, "ERROR: file %s  line %d  function %s\n\n", file, line, function);
+    fprintf(log, "%s\n", sched_errstr[err + 1]);
+
+    printf (     "ERROR: file %s  line %d  function %s\n",   file, line, function);
+    printf (     "%s\n\n", sched_errstr[err + 1]);
+
+    fclose(log);
+}
+
+//------------------------------------------------------------------------------
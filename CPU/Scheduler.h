@@ -0,0 +1,216 @@
+/*------------------------------------------------------------------------------
+    * File:        Scheduler.h                                                 *
+    * Description: Declaration of functions and data types used for running    *
+                   many cpus on a few worker threads                           *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef SCHEDULER_H_INCLUDED
+#define SCHEDULER_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+
+#include "CPU.h"
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Scheduler errors                                            *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+enum SchedulerErrors
+{
+    SCHED_NOT_OK = -1                                                  ,
+    SCHED_OK = 0                                                       ,
+    SCHED_NO_MEMORY                                                    ,
+
+    SCHED_DESTRUCTED                                                   ,
+    SCHED_NULL_INPUT_SCHEDULER_PTR                                     ,
+    SCHED_NULL_INPUT_TASK_PTR                                          ,
+};
+
+char const * const sched_errstr[] =
+{
+    "ERROR"                                                            ,
+    "OK"                                                               ,
+    "Failed to allocate memory"                                        ,
+
+    "Scheduler has already destructed"                                 ,
+    "The input value of the scheduler pointer turned out to be zero"   ,
+    "The input value of the task pointer turned out to be zero"        ,
+};
+
+#define SCHED_ASSERTOK(cond, err) if (cond)                                                               \
+                                  {                                                                       \
+                                    SchedPrintError(CPU_LOGNAME, __FILE__, __LINE__, __FUNC_NAME__, err); \
+                                    return err;                                                           \
+                                  } //
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Scheduler constants and types                               *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+const size_t DEFAULT_BUDGET = 10000;
+
+class Scheduler;
+
+struct SchedTask
+{
+    CPU* cpu    = nullptr;
+    int  result = PROCESS_PAUSED;
+
+    // a task waiting for its I/O is parked out of the queues until a request is done
+    Scheduler* scheduler = nullptr;
+    size_t     home      = 0;
+    bool       parked    = false;
+    bool       io_done   = false;
+};
+
+struct SchedQueue
+{
+    std::mutex              lock;
+    std::deque<SchedTask*>  tasks;
+};
+
+class Scheduler
+{
+private:
+
+    int state_;
+
+    SchedQueue* queues_      = nullptr;
+    size_t      workers_num_ = 0;
+    size_t      budget_      = 0;
+
+    std::atomic<size_t> pending_;
+    std::atomic<size_t> next_queue_;
+
+    // idle workers sleep until a task is queued or all tasks are done
+    std::mutex              lock_;
+    std::condition_variable ready_;
+    size_t                  wakes_ = 0;
+
+public:
+
+//------------------------------------------------------------------------------
+/*! @brief   Scheduler constructor.
+ *
+ *  @param   workers     Number of worker threads, 0 means number of cores
+ *  @param   budget      Number of instructions a cpu executes before it gives way to the others
+ */
+
+    Scheduler (size_t workers = 0, size_t budget = DEFAULT_BUDGET);
+
+//------------------------------------------------------------------------------
+/*! @brief   Scheduler copy constructor (deleted).
+ *
+ *  @param   obj         Source scheduler
+ */
+
+    Scheduler (const Scheduler& obj);
+
+    Scheduler& operator = (const Scheduler& obj); // deleted
+
+//------------------------------------------------------------------------------
+/*! @brief   Scheduler destructor.
+ */
+
+   ~Scheduler ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Add a task to the queue of one of the workers.
+ *
+ *  @note    The task and its cpu must live until the end of Run.
+ *
+ *  @param   task        Pointer to the task
+ *
+ *  @return  error code
+ */
+
+    int Add (SchedTask* task);
+
+//------------------------------------------------------------------------------
+/*! @brief   Run all added tasks until each of them finishes.
+ *
+ *  @note    A cpu runs for the budget of instructions and goes to the end of the queue.
+ *           A worker with the empty queue steals tasks from the others, and sleeps
+ *           when there is nothing to steal. A cpu paused on await is queued again
+ *           only when one of its requests is done.
+ *           The result of Run of each cpu is put to the result of its task.
+ *
+ *  @return  error code
+ */
+
+    int Run ();
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   Worker thread main loop.
+ *
+ *  @param   id          Number of the worker
+ */
+
+    void Worker (size_t id);
+
+//------------------------------------------------------------------------------
+/*! @brief   Take a task from the own queue or steal it from another worker.
+ *
+ *  @param   id          Number of the worker
+ *
+ *  @return  pointer to the task, nullptr if all queues are empty
+ */
+
+    SchedTask* Take (size_t id);
+
+//------------------------------------------------------------------------------
+/*! @brief   Put a task to the end of the queue and wake a sleeping worker.
+ *
+ *  @param   id          Number of the queue
+ *  @param   task        Pointer to the task
+ */
+
+    void Push (size_t id, SchedTask* task);
+
+//------------------------------------------------------------------------------
+/*! @brief   Queue the parked task again, called when its request is done.
+ *
+ *  @param   data        Pointer to the task
+ */
+
+    static void Wake (void* data);
+
+//------------------------------------------------------------------------------
+};
+
+//------------------------------------------------------------------------------
+/*! @brief   Prints an error wih description to the console and to the log file.
+ *
+ *  @param   logname     Name of the log file
+ *  @param   file        Name of the program file
+ *  @param   line        Number of line with an error
+ *  @param   function    Name of the function with an error
+ *  @param   err         Error code
+ */
+
+void SchedPrintError (const char* logname, const char* file, int line, const char* function, int err);
+
+//------------------------------------------------------------------------------
+
+#endif //SCHEDULER_H_INCLUDED
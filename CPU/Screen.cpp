@@ -0,0 +1,528 @@
+/*------------------------------------------------------------------------------
+    * File:        Screen.cpp                                                  *
+    * Description: Functions to saving screens of programs without a window    *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Screen.h"
+
+//------------------------------------------------------------------------------
+
+struct PNGChunk
+{
+    FILE*    fp;
+    uint32_t crc;
+};
+
+//------------------------------------------------------------------------------
+
+static uint32_t crc_table[256] = {};
+
+static void MakeCRCTable ()
+{
+    for (uint32_t n = 0; n < 256; ++n)
+    {
+        uint32_t c = n;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+
+        crc_table[n] = c;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void ChunkWrite (PNGChunk* chunk, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    for (size_t i = 0; i < size; ++i) chunk->crc = crc_table[(chunk->crc ^ bytes[i]) & 0xFF] ^ (chunk->crc >> 8);
+
+    fwrite(data, 1, size, chunk->fp);
+}
+
+//------------------------------------------------------------------------------
+
+static void Adler32 (uint32_t* a, uint32_t* b, const unsigned char* data, size_t size)
+{
+    // sums fit 32 bits for 5552 bytes, then they are reduced
+    while (size > 0)
+    {
+        size_t len = (size < 5552) ? size : 5552;
+
+        for (size_t i = 0; i < len; ++i)
+        {
+            *a += data[i];
+            *b += *a;
+        }
+        *a %= 65521;
+        *b %= 65521;
+
+        data += len;
+        size -= len;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+static void WriteBE32 (unsigned char* dst, uint32_t value)
+{
+    dst[0] = value >> 24;
+    dst[1] = value >> 16;
+    dst[2] = value >> 8;
+    dst[3] = value;
+}
+
+//------------------------------------------------------------------------------
+
+static void ChunkBegin (PNGChunk* chunk, const char* type, uint32_t size)
+{
+    unsigned char len[4] = {};
+    WriteBE32(len, size);
+    fwrite(len, 1, 4, chunk->fp);
+
+    chunk->crc = 0xFFFFFFFFu;
+    ChunkWrite(chunk, type, 4);
+}
+
+//------------------------------------------------------------------------------
+
+static void ChunkEnd (PNGChunk* chunk)
+{
+    unsigned char crc[4] = {};
+    WriteBE32(crc, chunk->crc ^ 0xFFFFFFFFu);
+    fwrite(crc, 1, 4, chunk->fp);
+}
+
+//------------------------------------------------------------------------------
+
+size_t VideoMemSize (size_t width, size_t height, int mode)
+{
+    assert((mode >= 0) && (mode < VIDEO_MODES_NUM));
+
+    return width * height * video_pixel_sizes[mode] + ((mode == VIDEO_INDEXED8) ? PALETTE_SIZE : 0);
+}
+
+//------------------------------------------------------------------------------
+
+// one loop without branches for each mode, so that the compiler vectorizes it
+template <size_t DST>
+static void ConvertPixels (unsigned char* dst, const unsigned char* video, size_t pixels, int mode)
+{
+    assert(dst   != nullptr);
+    assert(video != nullptr);
+
+    switch (mode)
+    {
+    case VIDEO_RGB888:
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            dst[i * DST + 0] = video[i * 3 + 0];
+            dst[i * DST + 1] = video[i * 3 + 1];
+            dst[i * DST + 2] = video[i * 3 + 2];
+            if (DST == 4) dst[i * DST + 3] = 255;
+        }
+        break;
+
+    case VIDEO_INDEXED8:
+    {
+        const unsigned char* palette = video;
+        const unsigned char* indices = video + PALETTE_SIZE;
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            dst[i * DST + 0] = palette[indices[i] * 3 + 0];
+            dst[i * DST + 1] = palette[indices[i] * 3 + 1];
+            dst[i * DST + 2] = palette[indices[i] * 3 + 2];
+            if (DST == 4) dst[i * DST + 3] = 255;
+        }
+        break;
+    }
+    case VIDEO_RGB565:
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            unsigned pixel = video[i * 2] | (video[i * 2 + 1] << 8);
+
+            // high bits are repeated in the low ones, so that 31 and 63 become 255
+            unsigned r = (pixel >> 11) & 0x1F;
+            unsigned g = (pixel >> 5)  & 0x3F;
+            unsigned b =  pixel        & 0x1F;
+
+            dst[i * DST + 0] = (r << 3) | (r >> 2);
+            dst[i * DST + 1] = (g << 2) | (g >> 4);
+            dst[i * DST + 2] = (b << 3) | (b >> 2);
+            if (DST == 4) dst[i * DST + 3] = 255;
+        }
+        break;
+
+    case VIDEO_RGBA8888:
+
+        for (size_t i = 0; i < pixels; ++i)
+        {
+            dst[i * DST + 0] = video[i * 4 + 0];
+            dst[i * DST + 1] = video[i * 4 + 1];
+            dst[i * DST + 2] = video[i * 4 + 2];
+            if (DST == 4) dst[i * DST + 3] = 255;
+        }
+        break;
+
+    default: assert(0);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void ConvertToRGB (unsigned char* rgb, const unsigned char* video, size_t pixels, int mode)
+{
+    ConvertPixels<3>(rgb, video, pixels, mode);
+}
+
+//------------------------------------------------------------------------------
+
+void ConvertToRGBA (unsigned char* rgba, const unsigned char* video, size_t pixels, int mode)
+{
+    ConvertPixels<4>(rgba, video, pixels, mode);
+}
+
+//------------------------------------------------------------------------------
+
+bool WritePNG (FILE* fp, const unsigned char* rgb, size_t width, size_t height)
+{
+    assert(fp  != nullptr);
+    assert(rgb != nullptr);
+
+    static bool crc_ready = (MakeCRCTable(), true);
+    assert(crc_ready);
+
+    size_t row    = 1 + 3 * width; // filter byte and pixels
+    size_t raw    = row * height;
+    size_t blocks = (raw + PNG_STORED_BLOCK - 1) / PNG_STORED_BLOCK;
+    size_t zlen   = 2 + raw + 5 * blocks + 4;
+
+    if ((width == 0) || (height == 0) || (zlen > UINT32_MAX)) return 0;
+
+    PNGChunk chunk = { fp, 0 };
+
+    fwrite(PNG_SIGNATURE, 1, 8, fp);
+
+    // 8 bits per channel, truecolor, no interlace
+    unsigned char header[13] = {};
+    WriteBE32(header,     width);
+    WriteBE32(header + 4, height);
+    header[8] = 8;
+    header[9] = 2;
+
+    ChunkBegin(&chunk, "IHDR", sizeof(header));
+    ChunkWrite(&chunk, header, sizeof(header));
+    ChunkEnd  (&chunk);
+
+    ChunkBegin(&chunk, "IDAT", zlen);
+
+    const unsigned char zlib[2] = { 0x78, 0x01 };
+    ChunkWrite(&chunk, zlib, 2);
+
+    uint32_t adler_a = 1;
+    uint32_t adler_b = 0;
+
+    size_t left  = raw;  // bytes of the stream not written yet
+    size_t block = 0;    // bytes left in the current block
+    size_t pos   = 0;    // position in the current row
+
+    const unsigned char filter = 0;
+
+    while (left > 0)
+    {
+        if (block == 0)
+        {
+            block = (left < PNG_STORED_BLOCK) ? left : PNG_STORED_BLOCK;
+
+            unsigned char stored[5] = { (unsigned char)(block == left), (unsigned char)block, (unsigned char)(block >> 8),
+                                        (unsigned char)~block, (unsigned char)(~block >> 8) };
+            ChunkWrite(&chunk, stored, 5);
+        }
+
+        const unsigned char* data = (pos == 0) ? &filter : rgb + (raw - left) - (raw - left) / row - 1;
+        size_t               size = (pos == 0) ? 1 : row - pos;
+        if (size > block) size = block;
+
+        Adler32(&adler_a, &adler_b, data, size);
+        ChunkWrite(&chunk, data, size);
+
+        pos    = (pos + size) % row;
+        block -= size;
+        left  -= size;
+    }
+
+    unsigned char adler[4] = {};
+    WriteBE32(adler, (adler_b << 16) | adler_a);
+    ChunkWrite(&chunk, adler, 4);
+    ChunkEnd  (&chunk);
+
+    ChunkBegin(&chunk, "IEND", 0);
+    ChunkEnd  (&chunk);
+
+    return ! ferror(fp);
+}
+
+//------------------------------------------------------------------------------
+
+bool WriteQOI (FILE* fp, const unsigned char* rgb, size_t width, size_t height)
+{
+    assert(fp  != nullptr);
+    assert(rgb != nullptr);
+
+    if ((width == 0) || (height == 0) || (width > UINT32_MAX) || (height > UINT32_MAX)) return 0;
+
+    // 3 channels, sRGB
+    unsigned char header[14] = {};
+    memcpy(header, QOI_MAGIC, 4);
+    WriteBE32(header + 4, width);
+    WriteBE32(header + 8, height);
+    header[12] = 3;
+
+    fwrite(header, 1, sizeof(header), fp);
+
+    // opaque pixels seen before, alpha is always 255 and adds 255 * 11 to the hash
+    unsigned char index[64][3] = {};
+    bool          indexed[64]  = {};
+
+    unsigned char prev[3] = { 0, 0, 0 };
+    int           run     = 0;
+
+    unsigned char buf[4096] = {};
+    size_t        len       = 0;
+
+    size_t pixels = width * height;
+
+    for (size_t i = 0; i < pixels; ++i)
+    {
+        const unsigned char* px = rgb + i * 3;
+
+        // longest op is 4 bytes
+        if (len + 4 > sizeof(buf))
+        {
+            fwrite(buf, 1, len, fp);
+            len = 0;
+        }
+
+        if ((px[0] == prev[0]) && (px[1] == prev[1]) && (px[2] == prev[2]))
+        {
+            ++run;
+            if ((run == 62) || (i == pixels - 1))
+            {
+                buf[len++] = 0xC0 | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+
+        if (run > 0)
+        {
+            buf[len++] = 0xC0 | (run - 1);
+            run = 0;
+        }
+
+        int hash = (px[0] * 3 + px[1] * 5 + px[2] * 7 + 255 * 11) % 64;
+
+        if (indexed[hash] && (memcmp(index[hash], px, 3) == 0))
+        {
+            buf[len++] = hash;
+        }
+        else
+        {
+            memcpy(index[hash], px, 3);
+            indexed[hash] = true;
+
+            signed char dr = px[0] - prev[0];
+            signed char dg = px[1] - prev[1];
+            signed char db = px[2] - prev[2];
+
+            signed char dr_dg = dr - dg;
+            signed char db_dg = db - dg;
+
+            if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+            {
+                buf[len++] = 0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+            }
+            else if ((dg >= -32) && (dg <= 31) && (dr_dg >= -8) && (dr_dg <= 7) && (db_dg >= -8) && (db_dg <= 7))
+            {
+                buf[len++] = 0x80 | (dg + 32);
+                buf[len++] = ((dr_dg + 8) << 4) | (db_dg + 8);
+            }
+            else
+            {
+                buf[len++] = 0xFE;
+                buf[len++] = px[0];
+                buf[len++] = px[1];
+                buf[len++] = px[2];
+            }
+        }
+
+        memcpy(prev, px, 3);
+    }
+
+    fwrite(buf, 1, len, fp);
+
+    const unsigned char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    fwrite(padding, 1, sizeof(padding), fp);
+
+    return ! ferror(fp);
+}
+
+//------------------------------------------------------------------------------
+
+bool WriteScreen (const char* filename, int format, const unsigned char* rgb, size_t width, size_t height)
+{
+    assert(filename != nullptr);
+
+    FILE* fp = fopen(filename, "wb");
+    if (fp == nullptr) return 0;
+
+    bool written = (format == SCREEN_QOI) ? WriteQOI(fp, rgb, width, height)
+                                          : WritePNG(fp, rgb, width, height);
+
+    return (fclose(fp) == 0) && written;
+}
+
+//------------------------------------------------------------------------------
+
+FrameEncoder::FrameEncoder () { }
+
+//------------------------------------------------------------------------------
+
+FrameEncoder::~FrameEncoder ()
+{
+    Stop();
+}
+
+//------------------------------------------------------------------------------
+
+void FrameEncoder::setThreads (size_t threads)
+{
+    Stop();
+
+    std::lock_guard<std::mutex> guard(lock_);
+    threads_num_ = threads;
+}
+
+//------------------------------------------------------------------------------
+
+size_t FrameEncoder::getThreads () const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    return threads_num_;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameEncoder::Submit (const char* filename, int format, const unsigned char* rgb, size_t width, size_t height)
+{
+    assert(filename != nullptr);
+    assert(rgb      != nullptr);
+
+    // the copy is made before waiting, so that the cpu does not hold the pixels of RAM
+    Frame frame;
+    frame.filename = strdup(filename);
+    frame.format   = format;
+    frame.rgb      = (unsigned char*)malloc(width * height * 3);
+    frame.width    = width;
+    frame.height   = height;
+
+    if ((frame.filename == nullptr) || (frame.rgb == nullptr))
+    {
+        free(frame.filename);
+        free(frame.rgb);
+        return 0;
+    }
+
+    memcpy(frame.rgb, rgb, width * height * 3);
+
+    std::unique_lock<std::mutex> guard(lock_);
+
+    completed_.wait(guard, [&]{ return queue_.size() < SCREEN_QUEUE_DEPTH; });
+
+    queue_.push_back(frame);
+
+    if (threads_.empty())
+    {
+        for (size_t i = 0; i < threads_num_; ++i) threads_.push_back(std::thread(&FrameEncoder::Worker, this));
+    }
+    submitted_.notify_one();
+
+    bool ok = (failed_ == 0);
+    failed_ = 0;
+
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+
+bool FrameEncoder::Drain ()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+
+    completed_.wait(guard, [&]{ return queue_.empty() && (busy_ == 0); });
+
+    bool ok = (failed_ == 0);
+    failed_ = 0;
+
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+
+void FrameEncoder::Worker ()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+
+    while (true)
+    {
+        submitted_.wait(guard, [&]{ return stop_ || !queue_.empty(); });
+        if (queue_.empty()) return;
+
+        Frame frame = queue_.front();
+        queue_.pop_front();
+        ++busy_;
+
+        // the queue has a free place now
+        completed_.notify_all();
+
+        guard.unlock();
+
+        bool written = WriteScreen(frame.filename, frame.format, frame.rgb, frame.width, frame.height);
+
+        free(frame.filename);
+        free(frame.rgb);
+
+        guard.lock();
+
+        if (! written) ++failed_;
+        --busy_;
+
+        completed_.notify_all();
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void FrameEncoder::Stop ()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+    }
+    submitted_.notify_all();
+
+    for (size_t i = 0; i < threads_.size(); ++i) threads_[i].join();
+
+    std::lock_guard<std::mutex> guard(lock_);
+    threads_.clear();
+    stop_ = false;
+}
+
+//------------------------------------------------------------------------------
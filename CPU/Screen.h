@@ -0,0 +1,266 @@
+/*------------------------------------------------------------------------------
+    * File:        Screen.h                                                    *
+    * Description: Declaration of functions and data types used for saving     *
+                   screens of programs without a window                        *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef SCREEN_H_INCLUDED
+#define SCREEN_H_INCLUDED
+
+#include <assert.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Screen constants and types                                  *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+char const * const PNG_SIGNATURE = "\x89PNG\r\n\x1A\n";
+
+// deflate blocks without compression, so that pixels go to the file as they are in RAM
+const size_t PNG_STORED_BLOCK = 65535;
+
+char const * const QOI_MAGIC = "qoif";
+
+// video modes are set by the scrm register, pixels of RGB565 are little endian
+enum VideoModes
+{
+    VIDEO_RGB888                                                       ,
+    VIDEO_INDEXED8                                                     ,
+    VIDEO_RGB565                                                       ,
+    VIDEO_RGBA8888                                                     ,
+
+    VIDEO_MODES_NUM                                                    ,
+};
+
+const size_t video_pixel_sizes[] = { 3, 1, 2, 4 };
+
+// palette of the indexed mode is 256 RGB colors right before the pixels
+const size_t PALETTE_SIZE = 256 * 3;
+
+// frames copied and waiting for the encoders, the cpu waits when the queue is full
+const size_t SCREEN_QUEUE_DEPTH = 8;
+
+enum ScreenFormats
+{
+    SCREEN_PNG                                                         ,
+    SCREEN_QOI                                                         ,
+};
+
+char const * const screen_types[] =
+{
+    ".png"                                                             ,
+    ".qoi"                                                             ,
+};
+
+struct Frame
+{
+    char*          filename = nullptr;
+    int            format   = SCREEN_PNG;
+
+    unsigned char* rgb      = nullptr;
+    size_t         width    = 0;
+    size_t         height   = 0;
+};
+
+class FrameEncoder
+{
+private:
+
+    mutable std::mutex      lock_;
+    std::condition_variable submitted_;
+    std::condition_variable completed_;
+
+    std::deque<Frame>        queue_;
+    std::vector<std::thread> threads_;
+
+    size_t threads_num_ = 0;
+    size_t busy_        = 0;
+    size_t failed_      = 0;
+    bool   stop_        = false;
+
+public:
+
+//------------------------------------------------------------------------------
+/*! @brief   FrameEncoder constructor.
+ *
+ *  @note    Encoder threads start with the first frame.
+ */
+
+    FrameEncoder ();
+
+//------------------------------------------------------------------------------
+/*! @brief   FrameEncoder copy constructor (deleted).
+ *
+ *  @param   obj         Source frame encoder
+ */
+
+    FrameEncoder (const FrameEncoder& obj);
+
+    FrameEncoder& operator = (const FrameEncoder& obj); // deleted
+
+//------------------------------------------------------------------------------
+/*! @brief   FrameEncoder destructor, saves all submitted frames.
+ */
+
+   ~FrameEncoder ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Set number of encoder threads, saves the submitted frames first.
+ *
+ *  @param   threads     Number of threads, 0 means frames are not encoded in the background
+ */
+
+    void setThreads (size_t threads);
+
+//------------------------------------------------------------------------------
+/*! @brief   Get number of encoder threads.
+ *
+ *  @return  number of threads
+ */
+
+    size_t getThreads () const;
+
+//------------------------------------------------------------------------------
+/*! @brief   Copy the frame and queue it for saving.
+ *
+ *  @note    Waits while SCREEN_QUEUE_DEPTH frames are already queued.
+ *
+ *  @param   filename    Name of the image file
+ *  @param   format      SCREEN_PNG or SCREEN_QOI
+ *  @param   rgb         Pixels, 3 bytes each, row by row
+ *  @param   width       Image width
+ *  @param   height      Image height
+ *
+ *  @return  1 if queued and all earlier frames are saved, else 0
+ */
+
+    bool Submit (const char* filename, int format, const unsigned char* rgb, size_t width, size_t height);
+
+//------------------------------------------------------------------------------
+/*! @brief   Wait for all submitted frames.
+ *
+ *  @return  1 if all frames since the last check are saved, else 0
+ */
+
+    bool Drain ();
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   Encoder thread main loop.
+ */
+
+    void Worker ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Save all frames and stop the threads.
+ */
+
+    void Stop ();
+
+//------------------------------------------------------------------------------
+};
+
+
+//------------------------------------------------------------------------------
+/*! @brief   Get size of the video memory of a screen.
+ *
+ *  @param   width       Screen width
+ *  @param   height      Screen height
+ *  @param   mode        Video mode
+ *
+ *  @return  size of the video memory in bytes
+ */
+
+size_t VideoMemSize (size_t width, size_t height, int mode);
+
+//------------------------------------------------------------------------------
+/*! @brief   Convert pixels of the video memory to RGB, 3 bytes each.
+ *
+ *  @param   rgb         Destination of the pixels
+ *  @param   video       Video memory, palette first in the indexed mode
+ *  @param   pixels      Number of pixels
+ *  @param   mode        Video mode
+ */
+
+void ConvertToRGB (unsigned char* rgb, const unsigned char* video, size_t pixels, int mode);
+
+//------------------------------------------------------------------------------
+/*! @brief   Convert pixels of the video memory to opaque RGBA, 4 bytes each.
+ *
+ *  @param   rgba        Destination of the pixels
+ *  @param   video       Video memory, palette first in the indexed mode
+ *  @param   pixels      Number of pixels
+ *  @param   mode        Video mode
+ */
+
+void ConvertToRGBA (unsigned char* rgba, const unsigned char* video, size_t pixels, int mode);
+
+//------------------------------------------------------------------------------
+/*! @brief   Write RGB pixels to a PNG file.
+ *
+ *  @note    Pixels are stored without compression, one pass over them and no buffers.
+ *
+ *  @param   fp          Pointer to the file
+ *  @param   rgb         Pixels, 3 bytes each, row by row
+ *  @param   width       Image width
+ *  @param   height      Image height
+ *
+ *  @return  1 if written, else 0
+ */
+
+bool WritePNG (FILE* fp, const unsigned char* rgb, size_t width, size_t height);
+
+//------------------------------------------------------------------------------
+/*! @brief   Write RGB pixels to a QOI file.
+ *
+ *  @note    QOI is lossless and much faster to encode than deflate.
+ *
+ *  @param   fp          Pointer to the file
+ *  @param   rgb         Pixels, 3 bytes each, row by row
+ *  @param   width       Image width
+ *  @param   height      Image height
+ *
+ *  @return  1 if written, else 0
+ */
+
+bool WriteQOI (FILE* fp, const unsigned char* rgb, size_t width, size_t height);
+
+//------------------------------------------------------------------------------
+/*! @brief   Write RGB pixels to an image file.
+ *
+ *  @param   filename    Name of the image file
+ *  @param   format      SCREEN_PNG or SCREEN_QOI
+ *  @param   rgb         Pixels, 3 bytes each, row by row
+ *  @param   width       Image width
+ *  @param   height      Image height
+ *
+ *  @return  1 if written, else 0
+ */
+
+bool WriteScreen (const char* filename, int format, const unsigned char* rgb, size_t width, size_t height);
+
+//------------------------------------------------------------------------------
+
+#endif //SCREEN_H_INCLUDED
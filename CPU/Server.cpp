@@ -0,0 +1,345 @@
+/*------------------------------------------------------------------------------
+    * File:        Server.cpp                                                  *
+    * Description: Functions to serving run requests on a unix socket with     *
+                   warm cpus                                                   *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include "Server.h"
+
+//------------------------------------------------------------------------------
+
+Server::Server (const char* path, size_t workers, size_t max_steps) :
+    state_       (SERVER_OK),
+    workers_num_ (workers),
+    max_steps_   (max_steps)
+{
+    if (workers_num_ == 0) workers_num_ = std::thread::hardware_concurrency();
+    if (workers_num_ == 0) workers_num_ = 1;
+
+    if (path == nullptr)
+        state_ = SERVER_NULL_INPUT_SOCKET_NAME;
+    else
+    if (strlen(path) >= sizeof(path_))
+        state_ = SERVER_LONG_SOCKET_NAME;
+    else
+        strcpy(path_, path);
+}
+
+//------------------------------------------------------------------------------
+
+Server::~Server ()
+{
+    assert(this != nullptr);
+
+    if (state_ == SERVER_DESTRUCTED) return;
+
+    if (socket_ >= 0)
+    {
+        close(socket_);
+        if (bound_) unlink(path_);
+        socket_ = -1;
+    }
+
+    state_ = SERVER_DESTRUCTED;
+}
+
+//------------------------------------------------------------------------------
+
+int Server::Serve ()
+{
+    SERVER_ASSERTOK((this == nullptr), SERVER_NULL_INPUT_SERVER_PTR);
+    SERVER_ASSERTOK(state_, state_);
+
+    socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    SERVER_ASSERTOK((socket_ < 0), SERVER_SOCKET_ERROR);
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path_);
+
+    // only a socket left by an old server is removed, not any file with this name
+    struct stat info = {};
+    if ((lstat(path_, &info) == 0) && S_ISSOCK(info.st_mode)) unlink(path_);
+
+    SERVER_ASSERTOK((bind(socket_, (sockaddr*)&addr, sizeof(addr)) < 0), SERVER_SOCKET_ERROR);
+    bound_ = true;
+
+    SERVER_ASSERTOK((listen(socket_, SERVER_BACKLOG) < 0), SERVER_SOCKET_ERROR);
+
+    std::thread* pool = new (std::nothrow) std::thread[workers_num_];
+    SERVER_ASSERTOK((pool == nullptr), SERVER_NO_MEMORY);
+
+    stop_ = false;
+
+    for (size_t i = 0; i < workers_num_; ++i)
+    {
+        pool[i] = std::thread(&Server::Worker, this);
+    }
+
+    printf("Serving on \"%s\" with %zu workers\n", path_, workers_num_);
+    fflush(stdout);
+
+    while (1)
+    {
+        int conn = accept(socket_, nullptr, nullptr);
+        if (conn < 0)
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (stop_) break;
+
+            continue;
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        conns_.push_back(conn);
+        ready_.notify_one();
+    }
+
+    ready_.notify_all();
+
+    for (size_t i = 0; i < workers_num_; ++i)
+    {
+        pool[i].join();
+    }
+
+    delete [] pool;
+
+    close(socket_);
+    unlink(path_);
+    socket_ = -1;
+    bound_  = false;
+
+    return SERVER_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void Server::Worker ()
+{
+    CPU cpu;
+    cpu.setLogging(false);
+    cpu.setHeadless(true);
+
+    while (1)
+    {
+        int conn = -1;
+        {
+            std::unique_lock<std::mutex> guard(lock_);
+            ready_.wait(guard, [this] { return stop_ || (! conns_.empty()); });
+
+            if (conns_.empty()) return;
+
+            conn = conns_.front();
+            conns_.pop_front();
+        }
+
+        Handle(&cpu, conn);
+    }
+}
+
+//------------------------------------------------------------------------------
+
+void Server::Handle (CPU* cpu, int conn)
+{
+    assert(cpu != nullptr);
+
+    // a client that never sends a newline must not hold the worker forever
+    timeval timeout = { SERVER_TIMEOUT, 0 };
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    char request[MAX_REQUEST_LEN] = "";
+    size_t len = 0;
+
+    while (len < MAX_REQUEST_LEN - 1)
+    {
+        ssize_t num = read(conn, request + len, MAX_REQUEST_LEN - 1 - len);
+        if (num < 0)
+        {
+            // timed out in the middle of the request, it is not run half read
+            close(conn);
+            return;
+        }
+        if (num == 0) break;
+
+        len += num;
+        if (memchr(request + len - num, '\n', num) != nullptr) break;
+    }
+    request[len] = '\0';
+    request[strcspn(request, "\r\n")] = '\0';
+
+    char* command = request + strspn(request, " \t");
+
+    char* program = command + strcspn(command, " \t");
+    if (*program != '\0') *program++ = '\0';
+    program += strspn(program, " \t");
+
+    char* input = program + strcspn(program, " \t");
+    if (*input != '\0') *input++ = '\0';
+
+    char*  answer     = nullptr;
+    size_t answer_len = 0;
+
+    FILE* out = open_memstream(&answer, &answer_len);
+    if (out == nullptr)
+    {
+        close(conn);
+        return;
+    }
+
+    if ((strcmp(command, "stop") == 0) && (! isOwner(conn)))
+    {
+        fprintf(out, ";;;; result: Only the owner of the server can stop it ;;;;\n");
+    }
+    else
+    if (strcmp(command, "stop") == 0)
+    {
+        fprintf(out, ";;;; stopped ;;;;\n");
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stop_ = true;
+        }
+
+        // wakes up accept in Serve
+        shutdown(socket_, SHUT_RDWR);
+    }
+    else
+    if ((strcmp(command, "run") != 0) || (*program == '\0'))
+    {
+        fprintf(out, ";;;; result: Wrong request, expected \"run <binary file> <input>\" or \"stop\" ;;;;\n");
+    }
+    else
+    {
+        std::shared_ptr<const ProgramImage> image = GetImage(program);
+
+        if (image == nullptr)
+            fprintf(out, ";;;; result: Input file is not found, steps: 0 ;;;;\n");
+        else
+        {
+            size_t request = KeepImage(program, image);
+
+            // requests for one program run at the same time, each saves its own screens
+            char progname[MAX_NAME_LEN] = "";
+            char scrname [MAX_NAME_LEN] = "";
+            strncpy(progname, program, MAX_NAME_LEN - 1);
+            snprintf(scrname, MAX_NAME_LEN, "%s.req%zu", GetTrueFileName(progname), request);
+
+            // the terminating zero is readable, so that an empty input is not an empty buffer
+            FILE* in = fmemopen(input, strlen(input) + 1, "r");
+
+            cpu->setIO(in, out);
+            cpu->setScreenName(scrname);
+
+            // a looping program gives the worker back at the step limit
+            int result = cpu->Load(image, program);
+            while ((result == CPU_OK) || (result == PROCESS_PAUSED))
+            {
+                if ((max_steps_ != 0) && (cpu->getSteps() >= max_steps_)) break;
+
+                size_t slice = (max_steps_ == 0) ? SERVER_SLICE : std::min(SERVER_SLICE, max_steps_ - cpu->getSteps());
+
+                result = cpu->Run(slice);
+                if (result != PROCESS_PAUSED) break;
+            }
+
+            cpu->setIO(nullptr, nullptr);
+            if (in != nullptr) fclose(in);
+
+            fflush(out);
+            if ((answer_len != 0) && (answer[answer_len - 1] != '\n')) fprintf(out, "\n");
+
+            if (result == PROCESS_PAUSED)
+                fprintf(out, ";;;; result: Step limit of the request is exceeded, steps: %zu ;;;;\n", cpu->getSteps());
+            else
+                fprintf(out, ";;;; result: %s, steps: %zu ;;;;\n", ((result > 0) ? cpu_errstr[result + 1] : "OK"), cpu->getSteps());
+        }
+    }
+
+    fclose(out);
+
+    // the client may leave early, it must not kill the server by SIGPIPE
+    for (size_t sent = 0; sent < answer_len; )
+    {
+        ssize_t num = send(conn, answer + sent, answer_len - sent, MSG_NOSIGNAL);
+        if (num <= 0) break;
+
+        sent += num;
+    }
+
+    free(answer);
+    close(conn);
+}
+
+//------------------------------------------------------------------------------
+
+size_t Server::KeepImage (const char* program, std::shared_ptr<const ProgramImage> image)
+{
+    assert(program != nullptr);
+
+    std::lock_guard<std::mutex> guard(lock_);
+
+    ++requests_;
+
+    auto found = images_.find(program);
+    if ((found == images_.end()) && (images_.size() >= SERVER_IMAGES_NUM))
+    {
+        auto oldest = images_.begin();
+        for (auto it = images_.begin(); it != images_.end(); ++it)
+        {
+            if (it->second.used < oldest->second.used) oldest = it;
+        }
+
+        images_.erase(oldest);
+    }
+
+    ServerImage& kept = images_[program];
+    kept.image = image;
+    kept.used  = requests_;
+
+    return requests_;
+}
+
+//------------------------------------------------------------------------------
+
+bool Server::isOwner (int conn)
+{
+    ucred cred = {};
+    socklen_t cred_len = sizeof(cred);
+
+    if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &cred_len) < 0) return false;
+
+    return (cred.uid == 0) || (cred.uid == getuid());
+}
+
+//------------------------------------------------------------------------------
+
+void ServerPrintError(const char* logname, const char* file, int line, const char* function, int err)
+{
+    assert(function != nullptr);
+    assert(logname  != nullptr);
+    assert(file     != nullptr);
+
+    FILE* log = fopen(logname, "a");
+    assert(log != nullptr);
+
+    time_t t = time(NULL);
+    struct tm tm = *localtime(&t);
+
+    fprintf(log, "###############################################################################\n");
+    fprintf(log, "TIME: %d-%02d-%02d %02d:%02d:%02d\n\n",
+            tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    fprintf(log, "ERROR: file %s  line %d  function %s\n\n", file, line, function);
+    fprintf(log, "%s\n", server_errstr[err + 1]);
+
+    printf (     "ERROR: file %s  line %d  function %s\n",   file, line, function);
+    printf (     "%s\n\n", server_errstr[err + 1]);
+
+    fclose(log);
+}
+
+//------------------------------------------------------------------------------
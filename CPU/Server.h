@@ -0,0 +1,217 @@
+/*------------------------------------------------------------------------------
+    * File:        Server.h                                                    *
+    * Description: Declaration of functions and data types used for serving   *
+                   run requests on a unix socket with warm cpus                *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef SERVER_H_INCLUDED
+#define SERVER_H_INCLUDED
+
+#include <condition_variable>
+#include <algorithm>
+#include <memory>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <unistd.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "CPU.h"
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Server errors                                               *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+enum ServerErrors
+{
+    SERVER_NOT_OK = -1                                                 ,
+    SERVER_OK = 0                                                      ,
+    SERVER_NO_MEMORY                                                   ,
+
+    SERVER_DESTRUCTED                                                  ,
+    SERVER_LONG_SOCKET_NAME                                            ,
+    SERVER_NULL_INPUT_SERVER_PTR                                       ,
+    SERVER_NULL_INPUT_SOCKET_NAME                                      ,
+    SERVER_SOCKET_ERROR                                                ,
+};
+
+char const * const server_errstr[] =
+{
+    "ERROR"                                                            ,
+    "OK"                                                               ,
+    "Failed to allocate memory"                                        ,
+
+    "Server has already destructed"                                    ,
+    "The socket name is too long"                                      ,
+    "The input value of the server pointer turned out to be zero"      ,
+    "The input value of the socket name turned out to be zero"         ,
+    "Failed to listen on the socket"                                   ,
+};
+
+#define SERVER_ASSERTOK(cond, err) if (cond)                                                                \
+                                   {                                                                        \
+                                     ServerPrintError(CPU_LOGNAME, __FILE__, __LINE__, __FUNC_NAME__, err); \
+                                     return err;                                                            \
+                                   } //
+
+
+//==============================================================================
+/*------------------------------------------------------------------------------
+                   Server constants and types                                  *
+*///----------------------------------------------------------------------------
+//==============================================================================
+
+
+char const * const SERVER_SOCKET   = "cpu.sock";
+const size_t       MAX_REQUEST_LEN = 4096;
+const int          SERVER_BACKLOG  = 64;
+const time_t       SERVER_TIMEOUT  = 5;   // seconds to wait for a slow client
+
+const size_t SERVER_SLICE      = 1 << 20;      // steps a request runs between the checks of its limit
+const size_t SERVER_MAX_STEPS  = 1000000000;   // default step limit of a request
+const size_t SERVER_IMAGES_NUM = 64;           // programs kept loaded between requests
+
+// program kept loaded by the server, the least recently used one goes first
+struct ServerImage
+{
+    std::shared_ptr<const ProgramImage> image;
+    size_t                              used = 0;
+};
+
+class Server
+{
+private:
+
+    int state_;
+
+    char   path_[sizeof(sockaddr_un::sun_path)] = "";
+    int    socket_      = -1;
+    size_t workers_num_ = 0;
+    size_t max_steps_   = 0;
+    bool   bound_       = false;  // the socket file is created by this server
+
+    std::mutex              lock_;
+    std::condition_variable ready_;
+    std::deque<int>         conns_;
+    bool                    stop_ = false;
+
+    // the image cache does not own images, the server keeps the ones it has run lately
+    std::unordered_map<std::string, ServerImage> images_;
+    size_t                                       requests_ = 0;
+
+public:
+
+//------------------------------------------------------------------------------
+/*! @brief   Server constructor.
+ *
+ *  @param   path        Name of the unix socket
+ *  @param   workers     Number of worker threads with warm cpus, 0 means number of cores
+ *  @param   max_steps   Step limit of a request, 0 means no limit
+ */
+
+    Server (const char* path = SERVER_SOCKET, size_t workers = 0, size_t max_steps = SERVER_MAX_STEPS);
+
+//------------------------------------------------------------------------------
+/*! @brief   Server copy constructor (deleted).
+ *
+ *  @param   obj         Source server
+ */
+
+    Server (const Server& obj);
+
+    Server& operator = (const Server& obj); // deleted
+
+//------------------------------------------------------------------------------
+/*! @brief   Server destructor.
+ */
+
+   ~Server ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Accept requests until the stop request.
+ *
+ *  @note    A request is one line: "run <binary file> <input>" or "stop". The answer
+ *           to the run request is the output of the program and the result line,
+ *           then the connection is closed. Only the owner of the server can stop it,
+ *           a client has SERVER_TIMEOUT seconds to send the request. A program
+ *           that runs over the step limit is stopped. The last SERVER_IMAGES_NUM
+ *           binary files are kept in memory, each worker keeps its cpu between
+ *           the requests. Screens of a request are named <program>.req<N>(K).
+ *
+ *  @return  error code
+ */
+
+    int Serve ();
+
+/*------------------------------------------------------------------------------
+                   Private functions                                           *
+*///----------------------------------------------------------------------------
+
+private:
+
+//------------------------------------------------------------------------------
+/*! @brief   Worker thread main loop, takes connections from the queue.
+ */
+
+    void Worker ();
+
+//------------------------------------------------------------------------------
+/*! @brief   Read the request from the connection and answer it.
+ *
+ *  @param   cpu         Pointer to the cpu of the worker
+ *  @param   conn        Connection socket
+ */
+
+    void Handle (CPU* cpu, int conn);
+
+//------------------------------------------------------------------------------
+/*! @brief   Keep the image of a program loaded, forgetting the least recently used one.
+ *
+ *  @param   program     Name of the binary file
+ *  @param   image       Image of the program
+ *
+ *  @return  number of the request
+ */
+
+    size_t KeepImage (const char* program, std::shared_ptr<const ProgramImage> image);
+
+//------------------------------------------------------------------------------
+/*! @brief   Check that the client runs as the same user as the server (or root).
+ *
+ *  @param   conn        Connection socket
+ *
+ *  @return  true if the client may stop the server
+ */
+
+    bool isOwner (int conn);
+
+//------------------------------------------------------------------------------
+};
+
+//------------------------------------------------------------------------------
+/*! @brief   Prints an error wih description to the console and to the log file.
+ *
+ *  @param   logname     Name of the log file
+ *  @param   file        Name of the program file
+ *  @param   line        Number of line with an error
+ *  @param   function    Name of the function with an error
+ *  @param   err         Error code
+ */
+
+void ServerPrintError (const char* logname, const char* file, int line, const char* function, int err);
+
+//------------------------------------------------------------------------------
+
+#endif //SERVER_H_INCLUDED
@@ -0,0 +1,43 @@
+/*------------------------------------------------------------------------------
+    * File:        Worker.cpp                                                  *
+    * Description: Functions for waiting for worker processes                  *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#include <sys/wait.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "Worker.h"
+
+//------------------------------------------------------------------------------
+
+pid_t WaitWorker (int* status)
+{
+    return wait(status);
+}
+
+//------------------------------------------------------------------------------
+
+bool GetWorkerCrash (int status, char* reason, size_t size)
+{
+    if (WIFSIGNALED(status))
+    {
+        snprintf(reason, size, "Worker was killed by signal %d (%s)", WTERMSIG(status), strsignal(WTERMSIG(status)));
+        return 1;
+    }
+
+    if (WIFEXITED(status) && (WEXITSTATUS(status) != 0))
+    {
+        snprintf(reason, size, "Worker exited with code %d", WEXITSTATUS(status));
+        return 1;
+    }
+
+    return 0;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,45 @@
+/*------------------------------------------------------------------------------
+    * File:        Worker.h                                                    *
+    * Description: Declaration of functions for waiting for worker processes   *
+    * Created:     19 oct 2026                                                 *
+    * Author:      Artem Puzankov                                              *
+    * Email:       puzankov.ao@phystech.edu                                    *
+    * GitHub:      https://github.com/hellopuza                                *
+    * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
+    *///------------------------------------------------------------------------
+
+#ifndef WORKER_H_INCLUDED
+#define WORKER_H_INCLUDED
+
+// <sys/wait.h> brings the register names of <signal.h> that conflict with the cpu
+// registers, so it is included only in Worker.cpp
+
+#include <sys/types.h>
+#include <stddef.h>
+
+
+//------------------------------------------------------------------------------
+/*! @brief   Wait for any worker process to finish.
+ *
+ *  @param   status      Pointer to the status of the finished process
+ *
+ *  @return  pid of the finished process, -1 if there are no worker processes
+ */
+
+pid_t WaitWorker (int* status);
+
+//------------------------------------------------------------------------------
+/*! @brief   Get the reason why the worker process crashed.
+ *
+ *  @param   status      Status of the finished process
+ *  @param   reason      String for the reason
+ *  @param   size        Size of the string
+ *
+ *  @return  1 if the process crashed, 0 if it finished normally
+ */
+
+bool GetWorkerCrash (int status, char* reason, size_t size);
+
+//------------------------------------------------------------------------------
+
+#endif //WORKER_H_INCLUDED
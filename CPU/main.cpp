@@ -8,21 +8,239 @@
     * Copyright © 2021 Artem Puzankov. All rights reserved.                    *
     *///------------------------------------------------------------------------
 
-#include "CPU.h"
+#include "Batch.h"
+#include "Server.h"
+#include "Memo.h"
+
+//------------------------------------------------------------------------------
+
+// options of a single program, any of them can be combined
+struct Options
+{
+    char*       program     = nullptr;
+    const char* restore     = nullptr;
+
+    const char* sandbox     = nullptr;
+    int         io_mode     = -1;
+    const char* record      = nullptr;
+    const char* replay      = nullptr;
+    const char* share       = nullptr;
+
+    bool        memory      = false;
+    size_t      mem_limit   = 0;
+
+    bool        headless    = false;
+    int         format      = SCREEN_PNG;
+    size_t      encoders    = 0;
+
+    const char* snapshot    = nullptr;
+    size_t      snap_steps  = 0;
+    const char* checkpoint  = nullptr;
+    size_t      check_steps = 0;
+};
+
+//------------------------------------------------------------------------------
+
+static bool isNumber (const char* str)
+{
+    if (*str == '\0') return false;
+
+    for (; *str != '\0'; ++str)
+    {
+        if (! isdigit((unsigned char)*str)) return false;
+    }
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+// --snapshot and --checkpoint take <steps> <file>, or <binary> <steps> <file> as
+// they were first documented, the binary is told apart by not being a number
+static bool ParseStop (int argc, char* argv[], int* i, Options* opts, size_t* steps, const char** file)
+{
+    int left = argc - *i - 1;
+
+    if ((left >= 3) && (! isNumber(argv[*i + 1])) && isNumber(argv[*i + 2]))
+    {
+        if (opts->program != nullptr) return false;
+        opts->program = argv[++*i];
+    }
+
+    if ((left < 2) || (! isNumber(argv[*i + 1]))) return false;
+
+    *steps = strtoull(argv[++*i], nullptr, 10);
+    *file  = argv[++*i];
+
+    return true;
+}
+
+//------------------------------------------------------------------------------
+
+static bool ParseOptions (int argc, char* argv[], Options* opts)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg  = argv[i];
+        int         left = argc - i - 1; // number of arguments after the current one
+
+        if      ((strcmp(arg, "--sandbox") == 0) && (left >= 1)) opts->sandbox = argv[++i];
+        else if ((strcmp(arg, "--record")  == 0) && (left >= 1)) opts->record  = argv[++i];
+        else if ((strcmp(arg, "--replay")  == 0) && (left >= 1)) opts->replay  = argv[++i];
+        else if ((strcmp(arg, "--share")   == 0) && (left >= 1)) opts->share   = argv[++i];
+        else if ((strcmp(arg, "--restore") == 0) && (left >= 1)) opts->restore = argv[++i];
+        else if  (strcmp(arg, "--headless") == 0)                opts->headless = true;
+        else if ((strcmp(arg, "--io") == 0) && (left >= 1))
+        {
+            ++i;
+            opts->io_mode = (strcmp(argv[i], "fast")   == 0) ? IO_FAST   :
+                            (strcmp(argv[i], "binary") == 0) ? IO_BINARY : IO_TEXT;
+        }
+        else if ((strcmp(arg, "--memory") == 0) && (left >= 1))
+        {
+            opts->memory    = true;
+            opts->mem_limit = strtoull(argv[++i], nullptr, 10);
+        }
+        else if ((strcmp(arg, "--frames") == 0) && (left >= 2))
+        {
+            opts->headless = true;
+            opts->encoders = strtoull(argv[++i], nullptr, 10);
+            opts->format   = (strcmp(argv[++i], "qoi") == 0) ? SCREEN_QOI : SCREEN_PNG;
+        }
+        else if (strcmp(arg, "--snapshot") == 0)
+        {
+            if (! ParseStop(argc, argv, &i, opts, &opts->snap_steps, &opts->snapshot)) return false;
+        }
+        else if (strcmp(arg, "--checkpoint") == 0)
+        {
+            if (! ParseStop(argc, argv, &i, opts, &opts->check_steps, &opts->checkpoint)) return false;
+        }
+        else if ((arg[0] != '-') && (opts->program == nullptr)) opts->program = argv[i];
+        else return false;
+    }
+
+    // a program comes either from its binary or from a snapshot
+    if ((opts->program == nullptr) == (opts->restore == nullptr)) return false;
+
+    // the snapshot and the checkpoints both decide where the program stops
+    return (opts->snapshot == nullptr) || (opts->checkpoint == nullptr);
+}
+
+//------------------------------------------------------------------------------
+
+static int RunProgram (CPU* cpu, const Options& opts)
+{
+    if (opts.sandbox  != nullptr) cpu->setSandbox(opts.sandbox);
+    if (opts.headless)            cpu->setHeadless(true);
+    if (opts.encoders || (opts.format != SCREEN_PNG)) cpu->setScreenFormat(opts.format, opts.encoders);
+    if (opts.memory)              cpu->setMemoryLimit(opts.mem_limit);
+
+    if (opts.io_mode >= 0)
+    {
+        // numbers go out in large blocks instead of a write per line
+        setvbuf(stdin,  nullptr, _IOFBF, IO_BUFFER_SIZE);
+        setvbuf(stdout, nullptr, _IOFBF, IO_BUFFER_SIZE);
+
+        cpu->setIOMode(opts.io_mode);
+    }
+
+    int err = CPU_OK;
+
+    if ((err == CPU_OK) && (opts.share  != nullptr)) err = cpu->Share (opts.share);
+    if ((err == CPU_OK) && (opts.record != nullptr)) err = cpu->Record(opts.record);
+    if ((err == CPU_OK) && (opts.replay != nullptr)) err = cpu->Replay(opts.replay);
+    if (err != CPU_OK) return (err > 0) ? err : 0;
+
+    if (opts.checkpoint != nullptr)
+    {
+        // an existing log means a restart, the program continues from its last checkpoint
+        FILE* log = fopen(opts.checkpoint, "rb");
+        if (log != nullptr)
+        {
+            fclose(log);
+            err = cpu->RestoreCheckpoint(opts.checkpoint);
+        }
+
+        while ((err == CPU_OK) && ((err = cpu->Run(opts.check_steps)) == PROCESS_PAUSED))
+        {
+            err = cpu->Checkpoint(opts.checkpoint);
+        }
+    }
+    else if (opts.snapshot != nullptr)
+    {
+        err = cpu->Run(opts.snap_steps);
+        if (err <= 0) err = cpu->Save(opts.snapshot);
+    }
+    else
+    {
+        // a restored program goes on from where it was saved
+        err = (opts.restore != nullptr) ? cpu->Run() : cpu->Execute();
+    }
+
+    // memory is printed while the cpu is alive, so that it shows what the program used
+    if (opts.memory) CPU::PrintMemory(stderr);
+
+    return (err > 0) ? err : 0;
+}
 
 //------------------------------------------------------------------------------
 
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    bool batch_threads   = (argc >= 3) && (argc <= 5) && (strcmp(argv[1], "--batch")      == 0);
+    bool batch_processes = (argc >= 3) && (argc <= 5) && (strcmp(argv[1], "--batch-fork") == 0);
+    bool batch_tasks     = (argc >= 3) && (argc <= 5) && (strcmp(argv[1], "--batch-sched") == 0);
+
+    if (batch_threads || batch_processes || batch_tasks)
+    {
+        Batch batch(argv[2], (argc == 5) ? atoi(argv[4]) : 0);
+
+        int err = (batch_threads)   ? batch.Run()          :
+                  (batch_processes) ? batch.RunProcesses() : batch.RunScheduled();
+        if (err) return err;
+
+        return batch.Write((argc >= 4) ? argv[3] : BATCH_RESULTS);
+    }
+
+    if ((argc >= 2) && (argc <= 5) && (strcmp(argv[1], "--serve") == 0))
+    {
+        Server server((argc >= 3) ? argv[2] : SERVER_SOCKET, (argc >= 4) ? atoi(argv[3]) : 0,
+                      (argc == 5) ? strtoull(argv[4], nullptr, 10) : SERVER_MAX_STEPS);
+
+        return server.Serve();
+    }
+
+    if ((argc >= 4) && (argc <= 5) && (strcmp(argv[1], "--cache") == 0))
     {
-        printf("wrong input parameters");
-        return 0;
+        // --cache <dir> [png|qoi] <binary>
+        Memo memo(argv[2], ((argc == 5) && (strcmp(argv[3], "qoi") == 0)) ? SCREEN_QOI : SCREEN_PNG);
+
+        int result = CPU_OK;
+        int err    = memo.Run(argv[argc - 1], &result);
+        if (err) return err;
+
+        return (result > 0) ? result : 0;
+    }
+
+    Options opts;
+
+    if (! ParseOptions(argc, argv, &opts))
+    {
+        printf("wrong input parameters\n");
+        return 1;
+    }
+
+    if (opts.restore != nullptr)
+    {
+        CPU cpu;
+
+        int err = cpu.Restore(opts.restore);
+        if (err != CPU_OK) return (err > 0) ? err : 0;
+
+        return RunProgram(&cpu, opts);
     }
-    
-    CPU cpu(argv[1]);
 
-    cpu.Execute();
+    CPU cpu(opts.program);
 
-    return 0;
+    return RunProgram(&cpu, opts);
 }
\ No newline at end of file
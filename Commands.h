@@ -15,17 +15,81 @@
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
+#include "Types.h"
 
 typedef unsigned int ptr_t;
 #define POINTER_PRINT_FORMAT "%u"
 #define PTR_MAX UINT_MAX
 
-#define INT_TYPE int
-#define FLT_TYPE double
+/*------------------------------------------------------------------------------
+                   Numeric variants                                            *
+*///----------------------------------------------------------------------------
+
+enum NumericVariants
+{
+    VARIANT_INT32_DOUBLE = 0x00,
+    VARIANT_INT64_DOUBLE = 0x01,
+    VARIANT_INT32_FLOAT  = 0x02,
+    VARIANT_INT32_FIXED  = 0x03,
+};
+
+char const * const variant_names[] =
+{
+    "int32/double" ,
+    "int64/double" ,
+    "int32/float"  ,
+    "int32/fixed"  ,
+};
+
+const int VARIANT_NUM = sizeof(variant_names) / sizeof(variant_names[0]);
+
+// Build with -DPROC_INT64_DOUBLE, -DPROC_INT32_FLOAT or -DPROC_INT32_FIXED to select a variant.
+// All tools of the toolchain have to be built with the same variant.
+
+#if defined (PROC_INT64_DOUBLE)
+
+    #define INT_TYPE long long
+    #define FLT_TYPE double
+
+    #define INT_PRINT_FORMAT "%lld"
+
+    const char NUM_VARIANT = VARIANT_INT64_DOUBLE;
+
+#elif defined (PROC_INT32_FLOAT)
+
+    #define INT_TYPE int
+    #define FLT_TYPE float
+
+    #define INT_PRINT_FORMAT "%d"
+
+    const char NUM_VARIANT = VARIANT_INT32_FLOAT;
+
+#elif defined (PROC_INT32_FIXED)
 
-#define INT_PRINT_FORMAT "%d"
+    #define INT_TYPE int
+    #define FLT_TYPE fixed_t
+
+    #define INT_PRINT_FORMAT "%d"
+
+    const char NUM_VARIANT = VARIANT_INT32_FIXED;
+
+#else
+
+    #define INT_TYPE int
+    #define FLT_TYPE double
+
+    #define INT_PRINT_FORMAT "%d"
+
+    const char NUM_VARIANT = VARIANT_INT32_DOUBLE;
+
+#endif
+
+// float numbers are printed after conversion to double
 #define FLT_PRINT_FORMAT "%lf"
 
+// registers hold both int numbers and pointers, so they are double in every variant
+#define REG_TYPE double
+
 #define PTR_TYPE unsigned int
 
 const size_t POINTER_SIZE     = sizeof(PTR_TYPE);
@@ -38,6 +102,23 @@ const int PTR_FLAG = 0x20;
 
 const int PROCESS_HALT = -666;
 
+/*------------------------------------------------------------------------------
+                   Binary header                                               *
+*///----------------------------------------------------------------------------
+
+char const * const BIN_SIGNATURE = "PZBC";
+const char         BIN_VERSION   = 1;
+
+struct BinHeader
+{
+    char signature[4] = {};
+    char version      = 0;
+    char variant      = 0;
+    char reserved[2]  = {};
+};
+
+const size_t BIN_HEADER_SIZE = sizeof(BinHeader);
+
 /*------------------------------------------------------------------------------
                    Commands codes                                              *
 *///----------------------------------------------------------------------------
@@ -81,6 +162,21 @@ enum CommandsCodes
     CMD_FLT2INT  = 0x22,
     CMD_INT2FLT  = 0x23,
     CMD_SCREEN   = 0x24,
+    CMD_SPAWN    = 0x25,
+    CMD_JOIN     = 0x26,
+    CMD_CAS      = 0x27,
+    CMD_XADD     = 0x28,
+    CMD_XCHG     = 0x29,
+    CMD_FENCE    = 0x2A,
+    CMD_HCALL    = 0x2B,
+    CMD_AREAD    = 0x2C,
+    CMD_AWRITE   = 0x2D,
+    CMD_AWAIT    = 0x2E,
+    CMD_APOLL    = 0x2F,
+    CMD_FLOAD    = 0x30,
+    CMD_FSTORE   = 0x31,
+    CMD_READY    = 0x32,
+    CMD_LCALL    = 0x33,
 };
 
 struct command
@@ -94,11 +190,20 @@ static command cmd_names[] =
     { CMD_ADD      ,  "add"     },
     { CMD_ADDQ     ,  "addq"    },
     { CMD_AND      ,  "and"     },
+    { CMD_APOLL    ,  "apoll"   },
+    { CMD_AREAD    ,  "aread"   },
+    { CMD_AWAIT    ,  "await"   },
+    { CMD_AWRITE   ,  "awrite"  },
     { CMD_CALL     ,  "call"    },
+    { CMD_CAS      ,  "cas"     },
     { CMD_COS      ,  "cos"     },
     { CMD_DIV      ,  "div"     },
     { CMD_DIVQ     ,  "divq"    },
+    { CMD_FENCE    ,  "fence"   },
+    { CMD_FLOAD    ,  "fload"   },
     { CMD_FLT2INT  ,  "flt2int" },
+    { CMD_FSTORE   ,  "fstore"  },
+    { CMD_HCALL    ,  "hcall"   },
     { CMD_HLT      ,  "hlt"     },
     { CMD_IN       ,  "in"      },
     { CMD_INQ      ,  "inq"     },
@@ -110,6 +215,8 @@ static command cmd_names[] =
     { CMD_JE       ,  "je"      },
     { CMD_JMP      ,  "jmp"     },
     { CMD_JNE      ,  "jne"     },
+    { CMD_JOIN     ,  "join"    },
+    { CMD_LCALL    ,  "lcall"   },
     { CMD_MUL      ,  "mul"     },
     { CMD_MULQ     ,  "mulq"    },
     { CMD_NEG      ,  "neg"     },
@@ -121,12 +228,16 @@ static command cmd_names[] =
     { CMD_POPQ     ,  "popq"    },
     { CMD_PUSH     ,  "push"    },
     { CMD_PUSHQ    ,  "pushq"   },
+    { CMD_READY    ,  "ready"   },
     { CMD_RET      ,  "ret"     },
     { CMD_SCREEN   ,  "screen"  },
     { CMD_SIN      ,  "sin"     },
+    { CMD_SPAWN    ,  "spawn"   },
     { CMD_SQRT     ,  "sqrt"    },
     { CMD_SUB      ,  "sub"     },
     { CMD_SUBQ     ,  "subq"    },
+    { CMD_XADD     ,  "xadd"    },
+    { CMD_XCHG     ,  "xchg"    },
     { CMD_XOR      ,  "xor"     },
 };
 
@@ -153,6 +264,7 @@ enum RegistersCodes
 
     REG_SCRX = 0x0B,
     REG_SCRY = 0x0C,
+    REG_SCRM = 0x0D,
 };
 
 struct reg
@@ -173,12 +285,49 @@ static command reg_names[] =
     { REG_RCX   ,  "rcx"  },
     { REG_RDX   ,  "rdx"  },
     { REG_RSP   ,  "rsp"  },
+    { REG_SCRM  ,  "scrm" },
     { REG_SCRX  ,  "scrx" },
     { REG_SCRY  ,  "scry" },
 };
 
 const int REG_NUM = sizeof(reg_names) / sizeof(reg_names[0]);
 
+/*------------------------------------------------------------------------------
+                   Host functions codes                                        *
+*///----------------------------------------------------------------------------
+
+// functions built into the cpu, the embedding program registers its own ones from HCALL_USER
+enum HostCallsCodes
+{
+    HCALL_ABS   = 0x00,
+    HCALL_EXP   = 0x01,
+    HCALL_FLOOR = 0x02,
+    HCALL_LOG   = 0x03,
+    HCALL_POW   = 0x04,
+
+    HCALL_USER  = 0x80,
+};
+
+static command hcall_names[] =
+{
+    { HCALL_ABS    ,  "abs"   },
+    { HCALL_EXP    ,  "exp"   },
+    { HCALL_FLOOR  ,  "floor" },
+    { HCALL_LOG    ,  "log"   },
+    { HCALL_POW    ,  "pow"   },
+};
+
+const int HCALL_NUM      = sizeof(hcall_names) / sizeof(hcall_names[0]);
+const int HOST_FUNCS_NUM = 256;
+
+/*------------------------------------------------------------------------------
+                   Code modules                                                *
+*///----------------------------------------------------------------------------
+
+// lcall is followed by the address of the module, the length of its name and the name,
+// the address is zero until the module is loaded. Names are short to fit the disassembler line.
+const size_t MODULE_NAME_LEN = 16;
+
 //------------------------------------------------------------------------------
 
 inline int isJUMP(char code)
@@ -190,7 +339,77 @@ inline int isJUMP(char code)
              (code == CMD_JAE ) ||
              (code == CMD_JB  ) ||
              (code == CMD_JBE ) ||
-             (code == CMD_CALL)   );
+             (code == CMD_CALL) ||
+             (code == CMD_SPAWN)  );
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Fill the binary header for the current numeric variant.
+ *
+ *  @param   header      Pointer to the header
+ */
+
+inline void MakeBinHeader (BinHeader* header)
+{
+    assert(header != nullptr);
+
+    memcpy(header->signature, BIN_SIGNATURE, sizeof(header->signature));
+    header->version = BIN_VERSION;
+    header->variant = NUM_VARIANT;
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Check that binary code starts with the header.
+ *
+ *  @param   data        Binary code
+ *  @param   size        Size of the binary code
+ *
+ *  @return  1 if the header is present, else 0
+ */
+
+inline int hasBinHeader (const char* data, size_t size)
+{
+    return ((size >= BIN_HEADER_SIZE) && (memcmp(data, BIN_SIGNATURE, sizeof(BinHeader::signature)) == 0));
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Read numeric variant from the binary header.
+ *
+ *  @note    Programs without the header were assembled before it appeared and target int32/double.
+ *
+ *  @param   data        Binary code
+ *  @param   size        Size of the binary code
+ *
+ *  @return  numeric variant, -1 if the header is broken
+ */
+
+inline int GetBinVariant (const char* data, size_t size)
+{
+    if (! hasBinHeader(data, size)) return VARIANT_INT32_DOUBLE;
+
+    const BinHeader* header = (const BinHeader*)data;
+    if ((header->version != BIN_VERSION) || (header->variant < 0) || (header->variant >= VARIANT_NUM))
+        return -1;
+
+    return header->variant;
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Remove the binary header, so that addresses in the code start from zero.
+ *
+ *  @param   data        Binary code
+ *  @param   size        Size of the binary code
+ *
+ *  @return  size of the code without the header
+ */
+
+inline size_t CutBinHeader (char* data, size_t size)
+{
+    if (! hasBinHeader(data, size)) return size;
+
+    memmove(data, data + BIN_HEADER_SIZE, size - BIN_HEADER_SIZE);
+
+    return size - BIN_HEADER_SIZE;
 }
 
 //------------------------------------------------------------------------------
@@ -16,7 +16,10 @@ Disassembler::Disassembler (const char* filename) :
     bcode_  (filename),
     output_ (DEFAULT_LINES_NUM, MAX_CHARS_IN_LINE),
     state_  (DSM_OK)
-{ }
+{
+    DSM_ASSERTOK((GetBinVariant(bcode_.data_, bcode_.size_) != NUM_VARIANT), DSM_WRONG_NUM_VARIANT, nullptr);
+    bcode_.size_ = CutBinHeader(bcode_.data_, bcode_.size_);
+}
 
 //------------------------------------------------------------------------------
 
@@ -88,6 +91,21 @@ int Disassembler::Disassemble ()
             reg_code = bcode_.data_[bcode_.ptr_++];
             DSM_ASSERTOK(((reg_code > REG_NUM) || (reg_code == 0)), DSM_UNIDENTIFIED_REGISTER, this);
         }
+        else if (cmd_code == CMD_HCALL)
+        {
+            DSM_ASSERTOK((bcode_.size_ - bcode_.ptr_ < 1), DSM_NO_SPACE_FOR_HOST_CALL, this);
+
+            reg_code = bcode_.data_[bcode_.ptr_++];
+        }
+        else if (cmd_code == CMD_LCALL)
+        {
+            DSM_ASSERTOK((bcode_.size_ - bcode_.ptr_ < POINTER_SIZE + 1), DSM_NO_SPACE_FOR_MODULE, this);
+
+            size_t len = (unsigned char)bcode_.data_[bcode_.ptr_ + POINTER_SIZE];
+            DSM_ASSERTOK(((len == 0) || (len > MODULE_NAME_LEN) || (bcode_.size_ - bcode_.ptr_ < POINTER_SIZE + 1 + len)), DSM_NO_SPACE_FOR_MODULE, this);
+
+            bcode_.ptr_ += POINTER_SIZE + 1 + len;
+        }
         else if (cmd_code == (CMD_PUSHQ | NUM_FLAG))
         {
             DSM_ASSERTOK((bcode_.size_ - bcode_.ptr_ < NUMBER_FLT_SIZE), DSM_NO_SPACE_FOR_NUMBER_FLT, this);
@@ -146,7 +164,8 @@ int Disassembler::Write (char* filename)
 
     FILE* fp = fopen(newname, "w");
 
-    fprintf(fp, ";;;; %s Disassembler ;;;;\n\n", filename);
+    fprintf(fp, ";;;; %s Disassembler ;;;;\n", filename);
+    fprintf(fp, ";;;; variant: %s ;;;;\n\n", variant_names[NUM_VARIANT]);
     fprintf(fp, "%s\n\n", "main:");
 
     labels_.pos_ = 0;
@@ -236,9 +255,33 @@ int Disassembler::writeOperands (Text* text, char cmd_code, char reg_code, INT_T
         len += strlen(reg_word);
     }
 
+    if (cmd_code == CMD_HCALL)
+    {
+        char hcall_word[16] = "";
+        sprintf(hcall_word, "%d", (unsigned char)reg_code);
+
+        for (int i = 0; i < HCALL_NUM; ++i)
+            if (hcall_names[i].code == reg_code)
+            {
+                strcpy(hcall_word, hcall_names[i].word);
+                break;
+            }
+
+        strcpy(text->lines_[line].str + startpos + len, hcall_word);
+        len += strlen(hcall_word);
+    }
+
+    if (cmd_code == CMD_LCALL)
+    {
+        size_t name_len = (unsigned char)bcode_.data_[bcode_.ptr_ + POINTER_SIZE];
+
+        memcpy(text->lines_[line].str + startpos + len, bcode_.data_ + bcode_.ptr_ + POINTER_SIZE + 1, name_len);
+        len += name_len;
+    }
+
     if ((flags & PTR_FLAG) && (flags & NUM_FLAG))
     {
-        char num_word[16] = "";
+        char num_word[32] = "";
         if (flags & REG_FLAG) sprintf(num_word, INT_PRINT_FORMAT,     num_int);
         else                  sprintf(num_word, POINTER_PRINT_FORMAT, num_ptr);
 
@@ -251,7 +294,7 @@ int Disassembler::writeOperands (Text* text, char cmd_code, char reg_code, INT_T
     else if (flags & NUM_FLAG)
     {
         char num_word[32] = "";
-        if (cmd_code == CMD_PUSHQ) sprintf(num_word, FLT_PRINT_FORMAT, num_flt);
+        if (cmd_code == CMD_PUSHQ) sprintf(num_word, FLT_PRINT_FORMAT, (double)num_flt);
         else                       sprintf(num_word, INT_PRINT_FORMAT, num_int);
 
         strcpy(text->lines_[line].str + startpos + len, num_word);
@@ -51,6 +51,8 @@ enum DisassemblerErrors
 
     DSM_DESTRUCTED                                                        ,
     DSM_LABELS_DESTRUCTED                                                 ,
+    DSM_NO_SPACE_FOR_HOST_CALL                                            ,
+    DSM_NO_SPACE_FOR_MODULE                                               ,
     DSM_NO_SPACE_FOR_NUMBER_INT                                           ,
     DSM_NO_SPACE_FOR_NUMBER_FLT                                           ,
     DSM_NO_SPACE_FOR_POINTER                                              ,
@@ -60,6 +62,7 @@ enum DisassemblerErrors
     DSM_NULL_INPUT_LABELS_PTR                                             ,
     DSM_UNIDENTIFIED_COMMAND                                              ,
     DSM_UNIDENTIFIED_REGISTER                                             ,
+    DSM_WRONG_NUM_VARIANT                                                 ,
 };
 
 char const * const dsm_errstr[] =
@@ -70,6 +73,8 @@ char const * const dsm_errstr[] =
 
     "Disassembler has already destructed"                                 ,
     "Labels have already destructed"                                      ,
+    "Not enough space to determine the host function"                     ,
+    "Not enough space to determine the code module"                       ,
     "Not enough space to determine the int number"                        ,
     "Not enough space to determine the float number"                      ,
     "Not enough space to determine the pointer"                           ,
@@ -79,6 +84,7 @@ char const * const dsm_errstr[] =
     "The input value of the labels pointer turned out to be zero"         ,
     "Unidentified command"                                                ,
     "Unidentified register"                                               ,
+    "Program was assembled for another numeric variant"                   ,
 };
 
 char const * const DISASSEMBLER_LOGNAME = "disassembler.log";
@@ -256,7 +262,7 @@ private:
  *
  *  @param   text        Pointer to the text
  *  @param   cmd_code    Command code
- *  @param   reg_code    Register code
+ *  @param   reg_code    Register code, or host function code for hcall
  *  @param   num_int     Int number
  *  @param   num_flt     Float number
  *  @param   num_ptr     Pointer number
@@ -29,23 +29,34 @@
 #endif // HASH_PROTECT
 
 
-#define STACK_CHECK if (Check ())                                                                                      \
-                    {                                                                                                  \
-                      FILE* log = fopen(STACK_LOGNAME, "a");                                                           \
-                      assert (log != nullptr);                                                                         \
-                      fprintf(log, "ERROR: file %s  line %d  function \"%s\"\n\n", __FILE__, __LINE__, __FUNC_NAME__); \
-                      printf (     "ERROR: file %s  line %d  function \"%s\"\n",   __FILE__, __LINE__, __FUNC_NAME__); \
-                      fclose(log);                                                                                     \
-                      Dump( __FUNC_NAME__, STACK_LOGNAME);                                                             \
-                      exit(errCode_);                                                                                  \
-                    } //
-
-
-#define STACK_ASSERTOK(cond, err) if (cond)                                                              \
-                                  {                                                                      \
-                                    printError (STACK_LOGNAME , __FILE__, __LINE__, __FUNC_NAME__, err); \
-                                    exit(err);                                                           \
-                                  } //
+#ifdef NO_EXIT
+
+    #define STACK_EXIT(err, ...) return __VA_ARGS__;
+
+#else
+
+    #define STACK_EXIT(err, ...) exit(err);
+
+#endif // NO_EXIT
+
+
+#define STACK_CHECK(...) if (Check ())                                                                                 \
+                         {                                                                                             \
+                           FILE* log = fopen(STACK_LOGNAME, "a");                                                      \
+                           assert (log != nullptr);                                                                    \
+                           fprintf(log, "ERROR: file %s  line %d  function \"%s\"\n\n", __FILE__, __LINE__, __FUNC_NAME__); \
+                           printf (     "ERROR: file %s  line %d  function \"%s\"\n",   __FILE__, __LINE__, __FUNC_NAME__); \
+                           fclose(log);                                                                                \
+                           Dump( __FUNC_NAME__, STACK_LOGNAME);                                                        \
+                           STACK_EXIT(errCode_, __VA_ARGS__)                                                           \
+                         } //
+
+
+#define STACK_ASSERTOK(cond, err, ...) if (cond)                                                              \
+                                       {                                                                      \
+                                         printError (STACK_LOGNAME , __FILE__, __LINE__, __FUNC_NAME__, err); \
+                                         STACK_EXIT(err, __VA_ARGS__)                                         \
+                                       } //
 
 const size_t DEFAULT_STACK_CAPACITY = 8;
 static int   stack_id   = 0;
@@ -135,6 +146,14 @@ public:
 
     size_t getSize () const;
 
+//------------------------------------------------------------------------------
+/*! @brief   Get capacity of the stack data.
+ *
+ *  @return  number of elements the stack data has room for
+ */
+
+    size_t getCapacity () const;
+
 //------------------------------------------------------------------------------
 /*! @brief   Get name of the stack.
  *
@@ -35,7 +35,7 @@ Stack<TYPE>::Stack (char* stack_name, size_t capacity) :
     stackhash_ = hash(this, SizeForHash());
 #endif // HASH_PROTECT
 
-    STACK_CHECK;
+    STACK_CHECK();
 
     DUMP_PRINT{ Dump(__FUNC_NAME__); }
 }
@@ -61,7 +61,7 @@ Stack<TYPE>::Stack (const Stack& obj) :
     stackhash_ = hash(this, SizeForHash());
 #endif // HASH_PROTECT
 
-    STACK_CHECK;
+    STACK_CHECK();
 
     DUMP_PRINT{ Dump(__FUNC_NAME__); }
 }
@@ -71,8 +71,8 @@ Stack<TYPE>::Stack (const Stack& obj) :
 template <typename TYPE>
 Stack<TYPE>& Stack<TYPE>::operator = (const Stack& obj)
 {
-    STACK_ASSERTOK((obj.capacity_ > MAX_CAPACITY), STACK_WRONG_INPUT_CAPACITY_VALUE_BIG);
-    STACK_ASSERTOK((obj.capacity_ == 0),           STACK_WRONG_INPUT_CAPACITY_VALUE_NIL);
+    STACK_ASSERTOK((obj.capacity_ > MAX_CAPACITY), STACK_WRONG_INPUT_CAPACITY_VALUE_BIG, *this);
+    STACK_ASSERTOK((obj.capacity_ == 0),           STACK_WRONG_INPUT_CAPACITY_VALUE_NIL, *this);
 
     size_cur_ = obj.size_cur_;
     capacity_ = obj.capacity_;
@@ -88,7 +88,7 @@ Stack<TYPE>& Stack<TYPE>::operator = (const Stack& obj)
     stackhash_ = hash(this, SizeForHash());
 #endif // HASH_PROTECT
 
-    STACK_CHECK;
+    STACK_CHECK(*this);
 
     DUMP_PRINT{ Dump(__FUNC_NAME__); }
 
@@ -133,9 +133,12 @@ Stack<TYPE>::~Stack ()
 template <typename TYPE>
 int Stack<TYPE>::Push (TYPE value)
 {
-    STACK_CHECK;
+    STACK_CHECK(errCode_);
 
-    if (size_cur_ == capacity_ - 1) Expand();
+    if (size_cur_ == capacity_ - 1)
+    {
+        STACK_ASSERTOK((Expand() != STACK_OK), STACK_NO_MEMORY, STACK_NO_MEMORY);
+    }
 
     data_[size_cur_++] = value;
 
@@ -144,7 +147,7 @@ int Stack<TYPE>::Push (TYPE value)
     stackhash_ = hash(this, SizeForHash());
 #endif // HASH_PROTECT
 
-    STACK_CHECK;
+    STACK_CHECK(errCode_);
 
     DUMP_PRINT{ Dump (__FUNC_NAME__); }
 
@@ -156,7 +159,7 @@ int Stack<TYPE>::Push (TYPE value)
 template <typename TYPE>
 TYPE Stack<TYPE>::Pop ()
 {
-    STACK_CHECK;
+    STACK_CHECK(POISON<TYPE>);
 
     if (size_cur_ == 0) errCode_ = STACK_EMPTY_STACK;
 
@@ -181,7 +184,7 @@ TYPE Stack<TYPE>::Pop ()
     stackhash_ = hash(this, SizeForHash());
 #endif // HASH_PROTECT
 
-    STACK_CHECK;
+    STACK_CHECK(POISON<TYPE>);
 
     DUMP_PRINT{ Dump (__FUNC_NAME__); }
 
@@ -193,7 +196,7 @@ TYPE Stack<TYPE>::Pop ()
 template <typename TYPE>
 void Stack<TYPE>::Clean ()
 {
-    STACK_CHECK;
+    STACK_CHECK();
 
     size_cur_ = 0;
     fillPoison();
@@ -210,7 +213,7 @@ void Stack<TYPE>::Clean ()
     stackhash_ = hash(this, SizeForHash());
 #endif // HASH_PROTECT
 
-    STACK_CHECK;
+    STACK_CHECK();
 
     DUMP_PRINT{ Dump (__FUNC_NAME__); }
 }
@@ -225,6 +228,14 @@ size_t Stack<TYPE>::getSize () const
 
 //------------------------------------------------------------------------------
 
+template <typename TYPE>
+size_t Stack<TYPE>::getCapacity () const
+{
+    return capacity_;
+}
+
+//------------------------------------------------------------------------------
+
 template <typename TYPE>
 const char* Stack<TYPE>::getName () const
 {
@@ -244,7 +255,7 @@ void Stack<TYPE>::setName (char* name)
 template <typename TYPE>
 TYPE& Stack<TYPE>::operator [] (size_t n)
 {
-    STACK_ASSERTOK((n >= capacity_), STACK_MEM_ACCESS_VIOLATION);
+    STACK_ASSERTOK((n >= capacity_), STACK_MEM_ACCESS_VIOLATION, data_[0]);
 
     return data_[n];
 }
@@ -254,7 +265,7 @@ TYPE& Stack<TYPE>::operator [] (size_t n)
 template <typename TYPE>
 const TYPE& Stack<TYPE>::operator [] (size_t n) const
 {
-    STACK_ASSERTOK((n >= capacity_), STACK_MEM_ACCESS_VIOLATION);
+    STACK_ASSERTOK((n >= capacity_), STACK_MEM_ACCESS_VIOLATION, data_[0]);
     
     return data_[n];
 }
@@ -281,9 +292,10 @@ int Stack<TYPE>::Expand ()
 {
     assert(this != nullptr);
 
-    capacity_ *= 2;
+    TYPE* temp = new (std::nothrow) TYPE[capacity_ * 2];
+    if (temp == nullptr) return STACK_NO_MEMORY;
 
-    TYPE* temp = temp = new TYPE[capacity_];
+    capacity_ *= 2;
 
     memcpy(temp, (char*)data_, capacity_ * sizeof(TYPE) / 2);
 
@@ -50,6 +50,8 @@
 
 #endif // NO_HASH
 
+// define NO_EXIT before including the stack to get errors from the stack functions instead of exit()
+
 
 char const * const STACK_LOGNAME = "stack.log";
 
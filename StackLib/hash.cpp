@@ -126,3 +126,34 @@ hash_t hash (void* buf, size_t size)
 }
 
 //------------------------------------------------------------------------------
+
+hash_t fast_hash (const void* buf, size_t size, hash_t seed)
+{
+    assert((buf != nullptr) || (size == 0));
+
+    const char* data = (const char*)buf;
+
+    hash_t hsh  = seed ^ (size * FAST_HASH_PRIME);
+    hash_t word = 0;
+
+    for (size_t i = 0; i < size; i += HASH_SIZE)
+    {
+        word = 0;
+        memcpy(&word, data + i, (size - i < HASH_SIZE) ? size - i : HASH_SIZE);
+
+        word ^= word >> 33;
+        word *= 0xFF51AFD7ED558CCDull;
+        word ^= word >> 33;
+
+        hsh = (hsh ^ word) * FAST_HASH_PRIME;
+        hsh = (hsh << 31) | (hsh >> 33);
+    }
+
+    hsh ^= hsh >> 33;
+    hsh *= 0xC4CEB9FE1A85EC53ull;
+    hsh ^= hsh >> 33;
+
+    return hsh;
+}
+
+//------------------------------------------------------------------------------
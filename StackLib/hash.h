@@ -31,6 +31,8 @@ typedef unsigned long long hash_t;
 #define HASH_PRINT_FORMAT "0x%016llX"
 
 static const size_t BLOCK_SIZE = 64;
+
+static const hash_t FAST_HASH_PRIME = 0x9E3779B97F4A7C15ull;
 static const size_t KEYS_NUM   = 16;
 
 static const size_t Keys[KEYS_NUM] =
@@ -64,6 +66,21 @@ int bit_rotate (void* buf, size_t size, int dir);
 
 hash_t hash (void* buf, size_t size);
 
+//------------------------------------------------------------------------------
+/*! @brief   Fast hash counting, reads memory by 8 bytes.
+ *
+ *  @note    Not compatible with hash(). The hash of several blocks is counted
+ *           by passing the hash of the previous block as the seed.
+ *
+ *  @param   buf  Start of memory to be hashable
+ *  @param   size Size of memory to be hashable
+ *  @param   seed Initial value of hash
+ *
+ *  @return  hash
+ */
+
+hash_t fast_hash (const void* buf, size_t size, hash_t seed = 0);
+
 //------------------------------------------------------------------------------
 
 #endif // HASH_H_INCLUDED
@@ -170,6 +170,25 @@ BinCode::BinCode (const char* filename) :
 
 //------------------------------------------------------------------------------
 
+BinCode::BinCode (const char* data, size_t size) :
+    state_ (STR_BINCODE_NOT_CONSTRUCTED)
+{
+    STR_ASSERTOK((this == nullptr), STR_NULL_INPUT_BINCODE_PTR);
+
+    if ((data == nullptr) || (size == 0)) return;
+
+    data_ = (char*)calloc(size + 2, 1);
+    if (data_ == nullptr) return;
+
+    memcpy(data_, data, size);
+
+    size_  = size;
+    ptr_   = 0;
+    state_ = STR_OK;
+}
+
+//------------------------------------------------------------------------------
+
 BinCode::~BinCode ()
 {
     STR_ASSERTOK((this == nullptr), STR_NULL_INPUT_BINCODE_PTR);
@@ -211,6 +230,68 @@ int BinCode::Expand ()
 
 //------------------------------------------------------------------------------
 
+int BinCode::Load (const char* data, size_t size)
+{
+    STR_ASSERTOK((this == nullptr), STR_NULL_INPUT_BINCODE_PTR);
+
+    if (data == nullptr) return STR_NULL_INPUT_BINCODE_PTR;
+    if (size == 0)       return STR_NULL_INPUT_BINCODE_SIZE;
+
+    void* temp = calloc(size + 2, 1);
+    if (temp == nullptr)
+        return STR_NO_MEMORY;
+
+    memcpy(temp, data, size);
+
+    if (state_ == STR_OK) free(data_);
+
+    data_  = (char*)temp;
+    size_  = size;
+    ptr_   = 0;
+    state_ = STR_OK;
+
+    return STR_OK;
+}
+
+//------------------------------------------------------------------------------
+
+int BinCode::Append (const char* data, size_t size)
+{
+    STR_ASSERTOK((this == nullptr), STR_NULL_INPUT_BINCODE_PTR);
+    STR_ASSERTOK(state_, state_);
+
+    if (data == nullptr) return STR_NULL_INPUT_BINCODE_PTR;
+    if (size == 0)       return STR_NULL_INPUT_BINCODE_SIZE;
+
+    void* temp = realloc(data_, size_ + size + 2);
+    if (temp == nullptr)
+        return STR_NO_MEMORY;
+
+    data_ = (char*)temp;
+    memcpy(data_ + size_, data, size);
+    size_ += size;
+
+    data_[size_] = data_[size_ + 1] = 0;
+
+    return STR_OK;
+}
+
+//------------------------------------------------------------------------------
+
+void BinCode::Borrow (char* data, size_t size)
+{
+    assert(this != nullptr);
+
+    if (state_ == STR_OK) free(data_);
+
+    data_  = data;
+    size_  = size;
+    ptr_   = 0;
+    state_ = STR_BINCODE_NOT_CONSTRUCTED;
+}
+
+//------------------------------------------------------------------------------
+
 char* GetFileName (int argc, char** argv)
 {
     assert(argc);
@@ -263,6 +344,66 @@ size_t CountSize (FILE* fp)
 
 //------------------------------------------------------------------------------
 
+bool CopyFile (const char* from, const char* to, size_t skip)
+{
+    assert(from != nullptr);
+    assert(to   != nullptr);
+
+    FILE* src = fopen(from, "rb");
+    if (src == nullptr) return 0;
+
+    if ((skip != 0) && (fseek(src, skip, SEEK_SET) != 0))
+    {
+        fclose(src);
+        return 0;
+    }
+
+    FILE* dst = fopen(to, "wb");
+    if (dst == nullptr)
+    {
+        fclose(src);
+        return 0;
+    }
+
+    char buffer[BUFSIZ] = "";
+    bool ok = 1;
+
+    for (size_t num = 0; ok && ((num = fread(buffer, 1, BUFSIZ, src)) != 0); )
+    {
+        ok = (fwrite(buffer, 1, num, dst) == num);
+    }
+
+    fclose(src);
+    ok = (fclose(dst) == 0) && ok;
+
+    return ok;
+}
+
+//------------------------------------------------------------------------------
+
+bool MakeDir (const char* path)
+{
+    assert(path != nullptr);
+
+    char dir[PATH_MAX] = "";
+    if (strlen(path) >= PATH_MAX) return 0;
+    strcpy(dir, path);
+
+    // parents are made one by one, an existing one is not an error
+    for (char* slash = strchr(dir + 1, '/'); slash != nullptr; slash = strchr(slash + 1, '/'))
+    {
+        *slash = '\0';
+        mkdir(dir, 0755);
+        *slash = '/';
+    }
+    mkdir(dir, 0755);
+
+    struct stat info = {};
+    return (stat(dir, &info) == 0) && S_ISDIR(info.st_mode);
+}
+
+//------------------------------------------------------------------------------
+
 char* GetText (FILE* fp, size_t len)
 {
     assert(fp != nullptr);
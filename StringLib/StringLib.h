@@ -15,6 +15,7 @@
 
 
 #include <sys/stat.h>
+#include <limits.h>
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
@@ -206,6 +207,17 @@ public:
 
     BinCode (const char* filename);
 
+//------------------------------------------------------------------------------
+/*! @brief   BinCode constructor from memory.
+ *
+ *  @note    The data is copied. If there is no data, BinCode stays not constructed.
+ *
+ *  @param   data        Pointer to the data
+ *  @param   size        Size of the data
+ */
+
+    BinCode (const char* data, size_t size);
+
 //------------------------------------------------------------------------------
 /*! @brief   BinCode copy constructor (deleted).
  *
@@ -230,6 +242,39 @@ public:
 
 int Expand ();
 
+//------------------------------------------------------------------------------
+/*! @brief   Replace the binary code data with a copy of other data.
+ *
+ *  @param   data        Pointer to the data
+ *  @param   size        Size of the data
+ *
+ *  @return  error code
+ */
+
+int Load (const char* data, size_t size);
+
+//------------------------------------------------------------------------------
+/*! @brief   Add a copy of other data to the end of the binary code data.
+ *
+ *  @param   data        Pointer to the data
+ *  @param   size        Size of the data
+ *
+ *  @return  error code
+ */
+
+int Append (const char* data, size_t size);
+
+//------------------------------------------------------------------------------
+/*! @brief   Use data of another owner as the binary code data without copying.
+ *
+ *  @note    The data is not freed by the binary code, the owner must keep it longer.
+ *
+ *  @param   data        Pointer to the data
+ *  @param   size        Size of the data
+ */
+
+void Borrow (char* data, size_t size);
+
 //------------------------------------------------------------------------------
 };
 
@@ -266,6 +311,28 @@ char* GetTrueFileName (char* filename);
 
 size_t CountSize (FILE* fp);
 
+//------------------------------------------------------------------------------
+/*! @brief   Copy a file.
+ *
+ *  @param   from        Name of the source file
+ *  @param   to          Name of the destination file
+ *  @param   skip        Number of bytes at the beginning of the source file not to copy
+ *
+ *  @return  1 if copied, else 0
+ */
+
+bool CopyFile (const char* from, const char* to, size_t skip = 0);
+
+//------------------------------------------------------------------------------
+/*! @brief   Create a directory with all missing parent directories.
+ *
+ *  @param   path        Name of the directory
+ *
+ *  @return  1 if the directory exists now, else 0
+ */
+
+bool MakeDir (const char* path);
+
 //------------------------------------------------------------------------------
 /*! @brief   Get text of the file.
  *
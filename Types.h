@@ -12,16 +12,52 @@
 #define TYPES_H
 
 #include <type_traits>
+#include <charconv>
 #include <limits.h>
+#include <ctype.h>
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
 
 
+//------------------------------------------------------------------------------
+/*! @brief   Fixed-point number with 16 integer and 16 fractional bits.
+ */
+
+struct fixed_t
+{
+    static const int FRAC_BITS = 16;
+
+    int raw = 0;
+
+    constexpr fixed_t () { }
+
+    constexpr fixed_t (double value) : raw ((int)(value * (1 << FRAC_BITS))) { }
+
+    operator double () const { return (double)raw / (1 << FRAC_BITS); }
+
+    static constexpr fixed_t fromRaw (int raw)
+    {
+        fixed_t num;
+        num.raw = raw;
+        return num;
+    }
+
+    fixed_t operator + (const fixed_t& obj) const { return fromRaw(raw + obj.raw); }
+    fixed_t operator - (const fixed_t& obj) const { return fromRaw(raw - obj.raw); }
+    fixed_t operator * (const fixed_t& obj) const { return fromRaw((int)(((long long)raw * obj.raw) >> FRAC_BITS)); }
+    fixed_t operator / (const fixed_t& obj) const { return fromRaw((int)(((long long)raw << FRAC_BITS) / obj.raw)); }
+    fixed_t operator - ()                   const { return fromRaw(-raw); }
+
+    bool operator == (const fixed_t& obj) const { return (raw == obj.raw); }
+};
+
+
 template<typename TYPE> const TYPE POISON;
 
     template<> constexpr double             POISON<double>             = NAN;
     template<> constexpr float              POISON<float>              = NAN;
+    template<> constexpr fixed_t            POISON<fixed_t>            = fixed_t::fromRaw(INT_MAX);
     template<> constexpr unsigned long long POISON<unsigned long long> = ULLONG_MAX;
     template<> constexpr long long          POISON<long long>          = LLONG_MAX;
     template<> constexpr long unsigned int  POISON<long unsigned int>  = ULONG_MAX;
@@ -38,6 +74,7 @@ template<typename TYPE> const char* PRINT_TYPE;
 
     template<> const char* const PRINT_TYPE<double>             = "double";
     template<> const char* const PRINT_TYPE<float>              = "float";
+    template<> const char* const PRINT_TYPE<fixed_t>            = "fixed_t";
     template<> const char* const PRINT_TYPE<unsigned long long> = "unsigned long long";
     template<> const char* const PRINT_TYPE<long long>          = "long long";
     template<> const char* const PRINT_TYPE<long unsigned int>  = "long unsigned int";
@@ -77,13 +114,8 @@ template<typename TYPE> const char* const PRINT_FORMAT;
 template <typename TYPE>
 bool isPOISON (TYPE value)
 {
-    if (value == POISON<TYPE>) return 1;
-
-    if (isnan(*(double*)&POISON<TYPE>))
-        if (isnan(*(double*)&value))
-            return 1;
-        else
-            return 0;
+    if constexpr (std::is_floating_point<TYPE>::value)
+        return isnan(value);
 
     else return (value == POISON<TYPE>);
 }
@@ -101,5 +133,107 @@ void TypePrint (FILE* fp, const TYPE& value)
     fprintf(fp, PRINT_FORMAT<TYPE>, value);
 }
 
+template <>
+inline void TypePrint (FILE* fp, const fixed_t& value)
+{
+    fprintf(fp, PRINT_FORMAT<double>, (double)value);
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Scan values of any type.
+ *
+ *  @param   fp          Pointer to input
+ *  @param   value       Pointer to the value
+ *
+ *  @return 1 if value was read, else 0
+ */
+
+template <typename TYPE>
+bool TypeScan (FILE* fp, TYPE* value)
+{
+    return (fscanf(fp, PRINT_FORMAT<TYPE>, value) == 1);
+}
+
+template <>
+inline bool TypeScan (FILE* fp, fixed_t* value)
+{
+    double num = 0;
+    if (fscanf(fp, PRINT_FORMAT<double>, &num) != 1) return 0;
+
+    *value = num;
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Print values of number types in the shortest form on a separate line.
+ *
+ *  @param   fp          Pointer to output
+ *  @param   value       Value to print
+ */
+
+template <typename TYPE>
+void TypePrintFast (FILE* fp, const TYPE& value)
+{
+    char buffer[64] = "";
+
+    char* end = std::to_chars(buffer, buffer + sizeof(buffer) - 1, value).ptr;
+    *end++ = '\n';
+
+    fwrite(buffer, 1, end - buffer, fp);
+}
+
+template <>
+inline void TypePrintFast (FILE* fp, const fixed_t& value)
+{
+    TypePrintFast(fp, (double)value);
+}
+
+//------------------------------------------------------------------------------
+/*! @brief   Scan values of number types separated by spaces.
+ *
+ *  @param   fp          Pointer to input
+ *  @param   value       Pointer to the value
+ *
+ *  @return 1 if value was read, else 0
+ */
+
+template <typename TYPE>
+bool TypeScanFast (FILE* fp, TYPE* value)
+{
+    char buffer[64] = "";
+    int  c   = 0;
+    int  len = 0;
+
+    flockfile(fp);
+
+    while (((c = getc_unlocked(fp)) != EOF) && isspace(c)) ;
+
+    while ((c != EOF) && !isspace(c) && (len < (int)sizeof(buffer)))
+    {
+        buffer[len++] = c;
+        c = getc_unlocked(fp);
+    }
+
+    // the character after the token stays in the input, so that the next token is whole
+    if (c != EOF) ungetc(c, fp);
+
+    funlockfile(fp);
+
+    // no number is as long as the buffer
+    if (len == (int)sizeof(buffer)) return 0;
+
+    return (len > 0) && (std::from_chars(buffer, buffer + len, *value).ptr == buffer + len);
+}
+
+template <>
+inline bool TypeScanFast (FILE* fp, fixed_t* value)
+{
+    double num = 0;
+    if (! TypeScanFast(fp, &num)) return 0;
+
+    *value = num;
+    return 1;
+}
+
 
 #endif // TYPES_H